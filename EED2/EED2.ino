@@ -21,15 +21,15 @@
 #include "PGA.h"
 #include "TVB.h"
 #include "menu.h"
+#include "eeflash.h"
+#include "eecache.h"
 #include <string.h>
 
 P3310 phone;
 PGA pga1;
 #define BootAniEnabled //to save time during tests
 
-//This put the phone in EEPROM writing mode
-//Everything written on the serial will be copied to the memory
-//#define EEWRITE
+//The EEPROM is programmed over serial at any time, see eeflash.cpp
 
 SPIEEPROM disk1(1); // parameter is type
 // type=0: 16-bits address
@@ -72,22 +72,27 @@ extern void setupT();
 extern void Smenu(uint8_t po = 0);
 
 unsigned long time;
+
+//ms per frame of each screen, see P3310::frameDue
+#define FRAME_MAIN 20 //like the old delay(20)
+#define FRAME_MENU 20
+#define FRAME_METER 50 //20 readings a second, like the old delay(50)
+//#define FRAMESTATS //print frame timing on serial
+FrameClock frames;
 unsigned long delBtn;
 char tmpS[10]; //temp string for printfs
 uint8_t tmpBtn;
 
-byte readB(long addr)
-{
-	return disk1.read_byte(addr);
-}
-void readM(long addr, byte * buff, long size)
-{
-	disk1.read_mem(addr, buff, size);
-}
-void writeM(long addr, byte * buff, int size)
-{
-	disk1.write(addr, buff, size);
-}
+EEStream eeStream; //bitmaps and animations are streamed, bypassing the cache
+
+//Bitmaps drawn here, looked up in the EEPROM asset directory so a new asset
+//image doesn't need a new build. BMP() falls back to the bmp.h address.
+const uint16_t PROGMEM assetsUsed[] = {
+	ASSET_bmp087, ASSET_bmp105, ASSET_bmp128, ASSET_bmp147, ASSET_bmp151, ASSET_bmp186,
+	ASSET_bmp330, ASSET_bmp331, ASSET_bmp332, ASSET_bmp333, ASSET_bmp334, ASSET_bmp335,
+	ASSET_bmpogo, ASSET_bootani
+};
+#define BMP(name) phone.asset(ASSET_##name, name)
 
 int freeRam () {
 	extern int __heap_start, *__brkval;
@@ -96,7 +101,8 @@ int freeRam () {
 }
 
 void setup() {
-	Serial.begin(57600);
+	Serial.begin(EEF_BAUD);
+	cacheFlush();
 	phone.IOinit();
 	phone.LCDinit(64,4);
 	phone.setBacklight(0);
@@ -105,14 +111,16 @@ void setup() {
 	
 	phone.EEreadbyte = &readB;
 	phone.EEreadmem = &readM;
+	phone.EEstream = &eeStream;
 	
-	MenuInit();
 	disk1.setup(); // setup disk1
+	assetsLoad();
 	
 	Serial.println("hello");
 	pga1.EEreadbyte = &readB;
 	pga1.EEreadmem = &readM;
 	pga1.EEwritemem = &writeM;
+	pga1.EEstream = &eeStream;
 	pga1.init();
 	
 	
@@ -122,17 +130,6 @@ void setup() {
 	
 	Serial.println(freeRam());
 	
-#ifdef EEWRITE
-	delay(3000);
-	disk1.start_write();
-	disk1.send_address(0); // send address
-	
-	//empty buffer
-	while (Serial.available()) {
-		Serial.read(); // Fetch the received byte value into the variable "ByteReceived"
-	}
-	tone(buzz, 1000, 200);
-#endif
 
 
 }
@@ -140,29 +137,7 @@ void setup() {
 uint8_t Power = 0;
 uint8_t Screen = 0;
 void loop() {
-#ifdef EEWRITE
-	if(phone.GetBtn())
-	{
-		digitalWrite(SLAVESELECT,HIGH);
-		
-		while (disk1.isWIP()) {
-			delay(1);
-		}
-		phone.setBacklight(0);
-		tone(buzz, 500, 20);
-		while(1);
-	}
-	/*while(1)
-	{
-		
-			Serial.print("batt: ");
-			Serial.print(phone.GetBatt());
-			Serial.print(" btn: ");
-			Serial.println(phone.GetBtn(),HEX);
-			//if(
-		delay(100);
-	}*/
-#else
+	eeflashPoll();
 	
 	Test();
 //Serial.print(Screen);
@@ -186,6 +161,7 @@ void loop() {
 		}
 		else if(Power == 1)
 		{
+			pga1.adcStop();
 			phone.setBacklight(0);
 			tone(buzz, 500, 20);
 			phone.clearDisplay();
@@ -196,19 +172,25 @@ void loop() {
 	}
 	if(Power == 0) return;
 	
+	//the rest of the frame goes back to the caller
+	if(!phone.frameDue(&frames, (Screen == 0) ? FRAME_MAIN : (Screen == 50) ? FRAME_METER : FRAME_MENU))
+	{
+		phone.bmpPrefetchStep();
+		return;
+	}
+	
 	switch(Screen)
 	{
 		case 0: //main screen
 			phone.clearDisplay();
 			phone.battBar();
-			phone.LCDputs("Menu", 5, 29, 0);
+			phone.LCDputsC("Menu", 5, 0);
 			phone.display();
 			if(phone.GetBtn() == BMm) //Menu
 			{
 				delBtn = millis() + 500;
 				Screen++;
 			}
-			delay(20);
 		break;
 		
 		case 1: //main menu
@@ -232,8 +214,30 @@ void loop() {
 			Screen = 1;
 			Smenu(1);
 			break;
+			
+		case 54:
+			Calibrate();
+			delBtn = millis() + 500;
+			Screen = 1;
+			Smenu(1);
+			break;
 		default: Screen = 1;
 	}
+	phone.frameEnd(&frames);
+#ifdef FRAMESTATS
+	Serial.print(frames.frameTime);
+	Serial.print(" ms, load ");
+	Serial.print(frames.load);
+	Serial.print("%, missed ");
+	Serial.print(frames.missed);
+#if EECACHE_LINES > 0
+	Serial.print(", EEPROM cache ");
+	Serial.print(eeHits);
+	Serial.print("/");
+	Serial.print(eeMisses);
+#endif
+	Serial.println();
+#endif
 
 	/*while(1)
 	{
@@ -254,7 +258,7 @@ void loop() {
 	phone.clearDisplay();
 	phone.LCDputs("1234567890", 0, 0, 0);
 	phone.LCDputsL("Phone book", 1, 5);
-	phone.putBmp(bmp087, 3, 12);
+	phone.putBmp(BMP(bmp087), 3, 12);
 	phone.LCDputs("Select", 5, 29, 0);
 	phone.display();
 	delay(3000);
@@ -274,7 +278,6 @@ while(1);
 		delay(2000);
 	}
 	delay(2000);*/
-#endif
 }
 
 void Smenu(uint8_t po)
@@ -293,14 +296,13 @@ void Smenu(uint8_t po)
 		case 1: //draw screen
 			sprintf(tmpS, "%d", CurMen+1);
 			phone.clearDisplay();
-			if(CurMen < 10) phone.LCDputs(tmpS, 0, LCDWIDTH-8, 0);
-				else phone.LCDputs(tmpS, 0, LCDWIDTH-16, 0);
+			phone.LCDputsR(tmpS, 0, LCDWIDTH-3, 0);
 			phone.LCDputsL(ms[CurMen].Name, 1, ms[CurMen].nPad);
 			phone.putBmp(ms[CurMen].Bmp, 3, 12);
-			phone.LCDputs("Select", 5, 29, 0);
+			phone.LCDputsC("Select", 5, 0);
 			phone.display();
 			tmp = 1; //animation index
-			delay(100);
+			phone.bmpPrefetch(ms[CurMen].Bmp + 130);
 			time = millis(); //prepare timer
 			Pos++;	
 		//break;
@@ -312,6 +314,7 @@ void Smenu(uint8_t po)
 				{
 					phone.putBmp(ms[CurMen].Bmp + (130*tmp++), 3, 12);
 					phone.display();
+					if(tmp < ms[CurMen].nAni) phone.bmpPrefetch(ms[CurMen].Bmp + (130*tmp));
 					time = millis();
 				}	
 			}
@@ -344,38 +347,45 @@ void Smenu(uint8_t po)
 	//while(phone.GetBtn() != 0) delay(20); //wait button release	
 }
 
+//Reads the asset directory, again after the EEPROM is programmed
+void assetsLoad(void)
+{
+	phone.assetLoad(assetsUsed, sizeof(assetsUsed) / sizeof(assetsUsed[0]));
+	MenuInit();
+}
+
 void MenuInit(void)
 {
 	tmpBtn = 0;
 
-	ms[tmpBtn].Bmp = bmp151;
+	ms[tmpBtn].Bmp = BMP(bmp151);
 	ms[tmpBtn].nAni = 13;
 	ms[tmpBtn].Name = "Multimeter";
-	ms[tmpBtn].nPad = 13;
 	tmpBtn++;
 	
-	ms[tmpBtn].Bmp = bmp186;
+	ms[tmpBtn].Bmp = BMP(bmp186);
 	ms[tmpBtn].nAni = 8;
 	ms[tmpBtn].Name = "TVBGone";
-	ms[tmpBtn].nPad = 15;
 	tmpBtn++;
 	
-	ms[tmpBtn].Bmp = bmp105;
+	ms[tmpBtn].Bmp = BMP(bmp105);
 	ms[tmpBtn].nAni = 12;
 	ms[tmpBtn].Name = "IRC";
-	ms[tmpBtn].nPad = 30;
 	tmpBtn++;
 	
-	ms[tmpBtn].Bmp = bmp147;
+	ms[tmpBtn].Bmp = BMP(bmp147);
 	ms[tmpBtn].nAni = 4;
 	ms[tmpBtn].Name = "Tetris";
-	ms[tmpBtn].nPad = 22;
 	tmpBtn++;
 	
-	ms[tmpBtn].Bmp = bmp128;
+	ms[tmpBtn].Bmp = BMP(bmp128);
 	ms[tmpBtn].nAni = 8;
 	ms[tmpBtn].Name = "Settings";
-	ms[tmpBtn].nPad = 18;
+	
+	//center the names once, they never change
+	for(tmpBtn = 0; tmpBtn < NumMenu; tmpBtn++)
+		ms[tmpBtn].nPad = (LCDWIDTH - phone.textWidth(ms[tmpBtn].Name, FONT_L)) / 2;
+	tmpBtn = 0;
 }
 
 //MULTIMETER STUFF
@@ -385,7 +395,11 @@ long tmpAmp;
 long tmpWatt;
 unsigned long tmpAvgWatt;
 long tmpAvgCount;
-double tmpOhm;
+long tmpOhm; //milliohm
+//Oversampling bits of each multimeter page: plain readings get the most,
+//graphs want fresh points more than digits, continuity wants speed.
+//2 bits (16 samples a channel, about 18 ms) is all a FRAME_METER frame fits.
+const uint8_t osPage[7] = {2, 1, 1, 1, 2, 2, 0};
 
 void PrintVolt(void){ //Put Voltage on tmpS
 	
@@ -444,10 +458,8 @@ void Graph(long *val, uint8_t row, uint16_t scale)
 		if(tmp >= LCDWIDTH)
 			tmp = 0;
 		
-		if(Gbuff[tmp] > 8)
-			phone.lcd_buffer[(row * LCDWIDTH) + i] |= (1 << (7-(Gbuff[tmp]-8)));
-		else
-			phone.lcd_buffer[((row+1) * LCDWIDTH) + i] |= (1 << (7-Gbuff[tmp]));
+		if(Gbuff[tmp] > 15) Gbuff[tmp] = 15;
+		phone.SetPx(i, (row * 8) + 15 - Gbuff[tmp]); //two banks, 0 at the bottom
 			
 		tmp++;
 	}
@@ -458,6 +470,7 @@ void Multimeter(void)
 {
 	long tmpl;
 	static uint8_t Pos = 0;
+	pga1.osBits = osPage[Pos];
 	switch (Pos)
 	{
 		case 0: // V A W
@@ -474,8 +487,7 @@ void Multimeter(void)
 			phone.LCDputsL(tmpS, 4, 10);
 			phone.LCDputsL("mW", 4, 62);
 
-			phone.display();
-			delay(50);
+			phone.displayAsync();
 		break;
 		case 1: // V A WG
 			phone.clearDisplay();
@@ -493,8 +505,7 @@ void Multimeter(void)
 
 			Graph(&tmpWatt, 4, 500);
 			
-			phone.display();
-			delay(50);
+			phone.displayAsync();
 		break;
 		case 2: // V W AG
 			phone.clearDisplay();
@@ -512,8 +523,7 @@ void Multimeter(void)
 
 			Graph(&tmpAmp, 4, 250);
 				
-			phone.display();
-			delay(50);
+			phone.displayAsync();
 		break;
 		case 3: // A W VG
 			phone.clearDisplay();
@@ -531,8 +541,7 @@ void Multimeter(void)
 
 			Graph(&tmpVolt, 4, 7000);
 			
-			phone.display();
-			delay(50);
+			phone.displayAsync();
 		break;		
 		case 4: // V A W avg
 			phone.clearDisplay();
@@ -556,36 +565,43 @@ void Multimeter(void)
 			Graph(&tmpWatt, 3, 500);
 			
 			phone.LCDputs("Reset", 5, 28, 0);
-			phone.display();
-			delay(50);
+			phone.displayAsync();
 		break;
 		case 5: //ohm
+			tmpOhm = pga1.MeasureRes(0);
+			if(tmpOhm == -1) break; //no reading yet, keep the last one
 			phone.clearDisplay();
-			tmpOhm = pga1.MeasureRes(0)+1;
-			if(tmpOhm > 3000) 
-			{
-				tmpOhm /= 1000;
-				phone.LCDputsL("Kohm", 0, 53);
-			}
+			if(tmpOhm == RES_OPEN)
+				phone.LCDputsL("Open", 0, 2);
+			else if(tmpOhm == RES_SHORT)
+				phone.LCDputsL("Short", 0, 2);
 			else
 			{
-				phone.LCDputsL("ohm", 0, 60);
+				if(tmpOhm > 3000000L) 
+				{
+					tmpOhm = (tmpOhm + 5000) / 10000; //Kohm, 2 decimals
+					phone.LCDputsL("Kohm", 0, 53);
+				}
+				else
+				{
+					tmpOhm = (tmpOhm + 5) / 10; //ohm, 2 decimals
+					phone.LCDputsL("ohm", 0, 60);
+				}
+				sprintf(tmpS, "%ld.%02ld", tmpOhm / 100, tmpOhm % 100);
+				phone.LCDputsL(tmpS, 0, 2);
 			}
-			
-			dtostrf(tmpOhm, 4,2,tmpS);//, "%f", tmpOhm);
-			phone.LCDputsL(tmpS, 0, 2);
-			phone.display();
-			delay(50);
+			phone.displayAsync();
 		break;
 		case 6: //ohm beep
 			tmpOhm = pga1.MeasureRes(1);
-			if(tmpOhm == 1)
+			if(tmpOhm == RES_SHORT)
 				PlayTune(0);
 			else
 				PlayTune(1);
 		break;
 	}
 	
+	pga1.adcStop(); //buttons are read with analogRead
 	tmpBtn = phone.GetBtn();
 	switch(tmpBtn)
 	{
@@ -627,6 +643,72 @@ void Multimeter(void)
 	
 	if(tmpBtn) delay(20);
 	while(phone.GetBtn() != 0) delay(50); //wait button release
+	if(Pos < 6) pga1.adcStart(); //sample until the next frame
+}
+
+//CALIBRATION
+//References for PGA::calRef, measure them with a good meter and put the values
+//here. Each covers about a decade of gains, together they cover all eight.
+const long PROGMEM calVRef[] = {24000, 5000, 500}; //mV
+const long PROGMEM calIRef[] = {500, 50, 5}; //mA
+#define CAL_RREF 10000 //ohm, a known resistor for the resistance readings
+
+//Shows a step, 1 when Menu goes on with it, 0 when C skips it
+uint8_t calStep(char *l1, char *l2)
+{
+	phone.clearDisplay();
+	phone.LCDputsC(l1, 1, 0);
+	phone.LCDputsC(l2, 2, 0);
+	phone.LCDputs("Menu:ok", 5, 0, 1);
+	phone.LCDputsR("C:skip", 5, LCDWIDTH, 1);
+	phone.display();
+	
+	pga1.adcStop(); //buttons are read with analogRead
+	while(phone.GetBtn() != 0) delay(20);
+	while(1)
+	{
+		tmpBtn = phone.GetBtn();
+		if(tmpBtn == BMm) break;
+		if(tmpBtn == BCm) return 0;
+		delay(20);
+	}
+	phone.clearDisplay();
+	phone.LCDputsC("Measuring", 2, 0);
+	phone.display();
+	return 1;
+}
+
+void Calibrate(void)
+{
+	long r;
+	uint8_t i;
+	
+	pga1.calReset(); //gains no reference reaches stay nominal
+	if(calStep("Short inputs", ""))
+	{
+		pga1.calZero(0);
+		pga1.calZero(1);
+	}
+	for(i = 0; i < sizeof(calVRef) / sizeof(calVRef[0]); i++)
+	{
+		r = pgm_read_dword(&calVRef[i]);
+		sprintf(tmpS, "%ld mV", r);
+		if(calStep("Apply", tmpS)) pga1.calRef(0, r);
+	}
+	sprintf(tmpS, "%ld ohm", (long)CAL_RREF);
+	if(calStep("Connect", tmpS)) pga1.calRes(CAL_RREF * 1000L); //after the voltages, it builds on them
+	for(i = 0; i < sizeof(calIRef) / sizeof(calIRef[0]); i++)
+	{
+		r = pgm_read_dword(&calIRef[i]);
+		sprintf(tmpS, "%ld mA", r);
+		if(calStep("Apply", tmpS)) pga1.calRef(1, r);
+	}
+	
+	//gains calibrated, FF is all, R after V when the resistor was
+	sprintf(tmpS, "V%02X%c A%02X", pga1.calDone(0), pga1.calResDone() ? 'R' : ' ', pga1.calDone(1));
+	if(calStep("Save gains", tmpS)) pga1.calSave();
+	else pga1.calLoad(); //back to what was there
+	pga1.adcStop();
 }
 
 void PlayTune(uint8_t Stop)
@@ -689,37 +771,47 @@ void Test(void)
 
 void BootAni(void)
 {
+	AniPlayer ani;
+	uint16_t a;
+	
 	#ifndef BootAniEnabled
 		return;
 	#endif
-	phone.putBmp(bmpogo, 0, 0);
+	phone.putBmp(BMP(bmpogo), 0, 0);
 	phone.display();
 	delay(2000);
-	phone.putBmp(bmp330, 0, 0);
+	
+	a = phone.asset(ASSET_bootani, 0xFFFF);
+	if(a != 0xFFFF) //images from assetc have the frames as one animation
+	{
+		phone.aniStart(&ani, a, 0, 0);
+		do
+		{
+			phone.display();
+			delay(250);
+		} while(phone.aniStep(&ani));
+		delay(2000 - 250);
+		return;
+	}
+	//older images only have the frames
+	phone.putBmp(BMP(bmp330), 0, 0);
 	phone.display();
 	delay(250);
-	phone.putBmp(bmp331, 0, 0);
+	phone.putBmp(BMP(bmp331), 0, 0);
 	phone.display();
 	delay(250);
-	phone.putBmp(bmp332, 0, 0);
+	phone.putBmp(BMP(bmp332), 0, 0);
 	phone.display();
 	delay(250);
-	phone.putBmp(bmp333, 0, 0);
+	phone.putBmp(BMP(bmp333), 0, 0);
 	phone.display();
 	delay(250);
-	phone.putBmp(bmp334, 0, 0);
+	phone.putBmp(BMP(bmp334), 0, 0);
 	phone.display();
 	delay(250);
-	phone.putBmp(bmp335, 0, 0);
+	phone.putBmp(BMP(bmp335), 0, 0);
 	phone.display();
 	delay(2000);
 }
 
 
-#ifdef EEWRITE
-void serialEvent() {
-	while (Serial.available()) {
-		SPI.transfer(Serial.read()); // Fetch the received byte value into the variable "ByteReceived"
-	}
-}
-#endif
@@ -20,6 +20,8 @@
 #include "PGA.h"
 #include <p3310.h>
 #include <SPI.h>
+#include <avr/interrupt.h>
+#include <util/crc16.h>
 
 void PGA::init()
 {
@@ -27,20 +29,7 @@ void PGA::init()
   	//SPI.begin(); //I assume I already did it earlier
 	//SPI.setDataMode(SPI_MODE0);
 	SetPGA(0,0);
-	/*EEreadmem(PGACalData, gains, 8);
-	
-	if(gains[0] == 0) //init calibration
-	{
-		gain[0] = 1;
-		gain[1] = 2;
-		gain[2] = 5;
-		gain[3] = 10;
-		gain[4] = 20;
-		gain[5] = 50;
-		gain[6] = 100;
-		gain[7] = 200;
-		EEwritemem(PGACalData, gains, 8);
-	}*/
+	calLoad();
 	analogReference(EXTERNAL); 
 }
 
@@ -50,14 +39,24 @@ void PGA::init()
 const int bitVal = 2; //mV
 //uint8_t *gains; //load from EEprom for calibration
 const uint8_t gains[8] = {1,2,5,10,20,50,100,200};
-//const int gainswitch[8] = {512,204,102,512,204,102,512,0};//When to switch up gain
-const int gainswitch[8] = {480,170,70,480,170,70,480,0};//When to switch up gain, with some room to play
 uint8_t channel = 0;
 uint8_t gain0 = 0;
 uint8_t gain1 = 0;
 long outval;
 const int center = 512;
 
+//Sampling engine state, shared with the ADC interrupt
+PGA *adcPGA;
+volatile uint32_t adcSum[2]; //samples since the last adcMean, per channel
+volatile uint16_t adcCount[2];
+volatile uint8_t adcG[2]; //gain wanted for each channel
+volatile uint8_t adcReload; //adcG of the current channel changed
+uint8_t adcCh; //channel being sampled
+uint8_t adcSent; //gain the PGA is set to
+uint8_t adcLeft; //samples before switching channel
+uint8_t adcSettle; //samples to drop
+uint8_t adcRunning;
+
 //boolean neg = false;
 /*
 void loop()
@@ -78,210 +77,440 @@ void loop()
 	}
 	
 }*/
-long PGA::MeasureCurrent(void)
+//Gain that brings val, read at gain g, closest to RANGE_UP without going over.
+//A clipped reading says nothing about how far over it is, so that one
+//drops to the lowest gain and the next reading picks the right one.
+static uint8_t targetGain(int val, uint8_t g)
 {
-	SetPGA(gain1, 1); //Switch to amp channel
+	uint8_t t = g;
 	
-	delay(25);
-	int val = analogRead(A0);
-	//val -= center;
+	if(val >= ADC_CLIP) return 0;
+	if(val > RANGE_DOWN) //close to full scale
+		while((t > 0) && (((long)val * gains[t] / gains[g]) > RANGE_UP)) t--;
+	else
+		while((t < 7) && (((long)val * gains[t + 1] / gains[g]) <= RANGE_UP)) t++;
+	return t;
+}
+
+//Mean of channel ch over the samples taken since the last call, in
+//1/2^osBits of an ADC step. Waits for at least n samples, and the 4^osBits
+//that make those bits real, up to ADC_WAIT ms past the time they take.
+//-1 if they don't come.
+int PGA::adcMean(uint8_t ch, uint16_t n)
+{
+	unsigned long t0 = millis();
+	uint16_t need, wait, count;
+	uint32_t sum;
+	uint8_t sreg;
 	
-	//if(abs(val) > 505) //Value too high, decrease gain
-	if(val > 1021) //Value too high, decrease gain
+	if(osBits > ADC_OS_MAX) osBits = ADC_OS_MAX;
+	need = 1 << (2 * osBits);
+	if(need < n) need = n;
+	//each channel gets half the rate, less the settling samples of its bursts
+	wait = ADC_WAIT + (uint16_t)((need * 2000UL * ADC_BURST) / ((unsigned long)ADC_RATE * (ADC_BURST - ADC_SETTLE)));
+	for(;;)
 	{
-		if(gain1 > 0)
+		sreg = SREG;
+		cli();
+		count = adcCount[ch];
+		sum = adcSum[ch];
+		if(count >= need)
 		{
-			SetPGA(--gain1, 1);
-			return -1;
-			//Serial.print("New gain: ");
-			//Serial.println(gains[gain]);
-		}
-		else
-		{//Overflow
-			return -1;
+			adcSum[ch] = 0;
+			adcCount[ch] = 0;
 		}
+		SREG = sreg;
+		if(count >= need) break;
+		if((millis() - t0) > wait) return -1;
 	}
-	//else if(abs(val) < gainswitch[gain]) //I have room to measure this with a higher gain, better accuracy
-	else if(val < gainswitch[gain1]) //I have room to measure this with a higher gain, better accuracy
-	{//Increase gain
-		if(gain1 < 7) //Shouldn't need this
-		{
-			SetPGA(++gain1, 1);
-			return -1;
-			//Serial.print("New gain: ");
-			//Serial.println(gains[gain]);
-		}
-	}
-	else
+	return ((sum << osBits) + (count / 2)) / count;
+}
+
+//Reads channel ch, setting its gain *g straight to the one the reading
+//asks for and reading again at once when it changes. Readings between
+//RANGE_UP and RANGE_DOWN keep the gain, so it doesn't flip on noise.
+//The reading is in 1/2^osBits steps, ADC_OVER when it clips at the lowest
+//gain, -1 when no samples come.
+int PGA::rangedRead(uint8_t ch, uint8_t *g)
+{
+	int val;
+	uint8_t t;
+	
+	adcStart();
+	for(uint8_t tries = 0; tries < 3; tries++) //clipped, lowest gain, right gain
 	{
-		//Serial.print(val);
-		//Serial.print(" -- ");
-		
-		//outval = val;
-		outval = ((val-1) << 1); //Val at AD input
-		//Serial.print(outval);
-		//Serial.print(" -- ");
-		
-		outval *= Vdiv;
-		outval /= gains[gain1];
-		outval /= R3;
-		//Serial.println(outval); //Original value
-		return outval/10; //milliamp
-		//delay(450);
+		val = adcMean(ch, tries ? ADC_FRESH : 1);
+		if(val < 0) return -1;
+		t = targetGain(val >> osBits, *g);
+		if(t == *g) return ((val >> osBits) >= ADC_CLIP) ? ADC_OVER : val;
+		*g = t;
+		adcGain(ch, t);
 	}
+	return -1;
+}
+
+long PGA::MeasureCurrent(void)
+{
+	int val = rangedRead(1, &gain1);
+	if(val < 0) return -1;
+	val = calApply(1, gain1, val);
+	
+	//val -= center;
+	//Serial.print(val);
+	//Serial.print(" -- ");
+	
+	//outval = val;
+	outval = ((long)(val - (1 << osBits)) << 1); //Val at AD input, osBits fraction bits
+	//Serial.print(outval);
+	//Serial.print(" -- ");
+	
+	outval *= Vdiv;
+	outval /= gains[gain1];
+	outval /= R3;
+	//Serial.println(outval); //Original value
+	return outval / (10L << osBits); //milliamp
+	//delay(450);
 }
 
 long PGA::MeasureVoltage(long Current) 
 {
-	SetPGA(gain0, 0); //Switch to voltage channel
+	int val = rangedRead(0, &gain0);
+	if(val < 0) return -1;
+	val = calApply(0, gain0, val);
 	
-	delay(25);
-	int val = analogRead(OPin);
-	//val -= center;	
+	//val -= center;
+	//Serial.print(val);
+	//Serial.print(" -- ");
 		
-	//if(abs(val) > 505) //Value too high, decrease gain
-	if(val > 1021) //Value too high, decrease gain
+	//outval = val;
+	outval = ((long)(val - (1 << osBits)) << 1); //Val at AD input, osBits fraction bits
+	//Serial.print(outval);
+	//Serial.print(" -- ");
+	
+	//Serial.print(outval);
+	//Serial.print(" -- ");
+	outval *= 100; //let's not lose too much precision, without having to use floats
+	
+	outval /= gains[gain0]; // before pga
+	
+	//If I'm measuring current at the same time, I have to subtract it from the raw voltage....
+	outval -= (Current*100) << osBits; //-offset
+	
+	outval *= Vdiv; //divider
+	/*outval *= Vdiv;
+	outval /= gains[gain0];
+	
+	outval -= Current*gains[gain0];*/
+	
+	//Serial.println(outval); //Original value
+	return outval / (100L << osBits);
+	//delay(450);
+}
+
+//Milliohms between the probes. The unknown is in series with R2 from vref,
+//so the voltage channel reads v = vref * R2 / (R2 + Rx), and
+//Rx = (vref - v) * R2 / v, in 32 bit integers. Autoranges like
+//MeasureVoltage. lowMode (continuity) stays at gain 0 without oversampling,
+//it only has to tell a short quickly. RES_SHORT, RES_OPEN, or -1 while
+//there are no samples.
+long PGA::MeasureRes(uint8_t lowMode)
+{
+	int val;
+	long n, num, q, r;
+	
+	if(lowMode)
 	{
-		if(gain0 > 0)
-		{
-			SetPGA(--gain0, 0);
-			return -1;
-			//Serial.print("New gain: ");
-			//Serial.println(gains[gain]);
-		}
-		else
-		{//Overflow
-			return -1;
-		}
-	}
-	//else if(abs(val) < gainswitch[gain]) //I have room to measure this with a higher gain, better accuracy
-	else if(val < gainswitch[gain0]) //I have room to measure this with a higher gain, better accuracy
-	{//Increase gain
-		if(gain0 < 7) //Shouldn't need this
-		{
-			SetPGA(++gain0, 0);
-			return -1;
-			//Serial.print("New gain: ");
-			//Serial.println(gains[gain]);
-		}
+		osBits = 0;
+		adcStart();
+		if(gain0 != 0) adcGain(0, gain0 = 0);
+		val = adcMean(0, 1);
+		if(val >= ADC_CLIP) return RES_SHORT;
 	}
 	else
 	{
-		//Serial.print(val);
-		//Serial.print(" -- ");
-			
-		//outval = val;
-		outval = ((val-1) << 1); //Val at AD input
-		//Serial.print(outval);
-		//Serial.print(" -- ");
-		
-		//Serial.print(outval);
-		//Serial.print(" -- ");
-		outval *= 100; //let's not lose too much precision, without having to use floats
-		
-		outval /= gains[gain0]; // before pga
-		
-		//If I'm measuring current at the same time, I have to subtract it from the raw voltage....
-		outval -= Current*100; //-offset
-		
-		outval *= Vdiv; //divider
-		/*outval *= Vdiv;
-		outval /= gains[gain0];
-		
-		outval -= Current*gains[gain0];*/
-		
-		//Serial.println(outval); //Original value
-		return outval/100;
-		//delay(450);
+		val = rangedRead(0, &gain0);
+		if(val == ADC_OVER) return RES_SHORT;
 	}
+	if(val < 0) return -1;
+	val = calResApply(val);
+	
+	n = ((long)val << 1) - (2 << osBits); //mV at the ADC, osBits fraction bits, like outval
+	if((n <= 0) || ((gain0 == 7) && ((val >> osBits) < RES_OPEN_STEPS))) return RES_OPEN;
+	//v is n / (gains << osBits), so Rx = num / n * R2 with
+	num = (((long)vref * gains[gain0]) << osBits) - n;
+	if(num <= 0) return RES_SHORT;
+	
+	//num * R2 * 100 (R2 in mohm) / n doesn't fit 32 bits, divide in two steps
+	q = num / n;
+	r = num % n;
+	if(q > (0x7FFFFFFFL - RES_LEAD) / (R2 * 100L)) return RES_OPEN; //over 2 Mohm
+	q *= R2 * 100L;
+	r *= R2; //r < n < 2^14, fits
+	q += ((r / n) * 100) + (((r % n) * 100) / n);
+	return q + RES_LEAD;
+}
+
+//Needs the bus, from SetPGA or the ADC interrupt when nobody has it
+static void pgaSend(uint8_t G, uint8_t Ch) {
+	channel = Ch;
+	// take the SS pin low to select the chip:
+	digitalWrite(OP_CS, LOW);
+	//  send in the address and value via SPI:
+	SPI.transfer(0x2A);
+	SPI.transfer((G<<4) + Ch);
+	// take the SS pin high to de-select the chip:
+	digitalWrite(OP_CS, HIGH);
+}
+
+void PGA::SetPGA(uint8_t G, uint8_t Ch) {
+	busTake(BUS_PGA);
+	pgaSend(G, Ch);
+	busRelease();
 }
 
-double PGA::MeasureRes(uint8_t lowMode)
+///CALIBRATION
+uint8_t PGA::calLoad(void)
 {
-	if(channel != 0)
+	uint8_t *p = (uint8_t *)&cal;
+	uint8_t hdr[3];
+	uint16_t crc = 0;
+	
+	//in one go from the stream when there is one, the hooks otherwise
+	if(EEstream)
 	{
-		if((lowMode != 0) && (gain0 != 0))
-			SetPGA(gain0, 0); //Switch to voltage channel
-		
-		if(lowMode == 0)
-			SetPGA(gain0, 0); //Switch to voltage channel
+		EEstream->open(PGACalData);
+		hdr[0] = EEstream->read();
+		EEstream->read(p, sizeof(cal));
+		EEstream->read(hdr + 1, 2);
+		EEstream->close();
 	}
-	//if(lowMode) gain0 = 0;
-	//if((channel != 0) || (gain0 != 0)) && (lowMode != 0
-	//	SetPGA(gain0, 0); //Switch to voltage channel
+	else
+	{
+		EEreadmem(PGACalData, hdr, 1);
+		EEreadmem(PGACalData + 1, p, sizeof(cal));
+		EEreadmem(PGACalData + 1 + sizeof(cal), hdr + 1, 2);
+	}
+	for(uint8_t i = 0; i < sizeof(cal); i++) crc = _crc_xmodem_update(crc, p[i]);
 	
-	//delay(25);
-	int val = analogRead(OPin);
-	//val -= center;
+	calValid = (hdr[0] == CAL_MAGIC) && (crc == (hdr[1] | (hdr[2] << 8)));
+	if(!calValid) memset(&cal, 0, sizeof(cal)); //nominal values
+	return calValid;
+}
+
+void PGA::calSave(void)
+{
+	uint8_t buf[sizeof(cal) + 3];
+	uint16_t crc = 0;
+	
+	buf[0] = CAL_MAGIC;
+	memcpy(buf + 1, &cal, sizeof(cal));
+	for(uint8_t i = 0; i < sizeof(cal); i++) crc = _crc_xmodem_update(crc, buf[1 + i]);
+	buf[sizeof(cal) + 1] = crc;
+	buf[sizeof(cal) + 2] = crc >> 8;
+	EEwritemem(PGACalData, buf, sizeof(buf));
+	calValid = 1;
+}
+
+//val in 1/2^osBits steps, read at gain g of channel ch, with only the zero
+//offset taken out. The nominal one step offset stays in.
+int PGA::calOffset(uint8_t ch, uint8_t g, int val)
+{
+	return val - (cal.e[ch][g].off >> (ADC_OS_MAX - osBits));
+}
+
+//Same with the gain corrected too. MeasureCurrent/Voltage take the one
+//step out.
+int PGA::calApply(uint8_t ch, uint8_t g, int val)
+{
+	long v = calOffset(ch, g, val) - (1 << osBits);
 	
-	//Serial.print("val ");
-	//Serial.println(val); //Original value
-	if(lowMode != 0)
+	v += (v * cal.e[ch][g].corr) >> 16;
+	return v + (1 << osBits);
+}
+
+//Mean of channel ch at gain g with all the oversampling, -1 if no samples
+int PGA::calRead(uint8_t ch, uint8_t g)
+{
+	uint8_t os = osBits;
+	int val;
+	
+	osBits = ADC_OS_MAX;
+	adcStart();
+	adcGain(ch, g);
+	val = adcMean(ch, ADC_CAL);
+	osBits = os;
+	return val;
+}
+
+void PGA::calReset(void)
+{
+	for(uint8_t ch = 0; ch < 2; ch++)
 	{
-		//Serial.print("volt");
-		//Serial.println(val); //Original value
-		if(val > 1020) //short!
-			return 1;
-		return 1/0;
-	}//if(abs(val) > 505) //Value too high, decrease gain
-	else if(val > 1021) //Value too high, decrease gain
+		for(uint8_t g = 0; g < 8; g++) cal.e[ch][g].corr = 0;
+		cal.done[ch] = 0;
+	}
+	cal.res = 0;
+	cal.resDone = 0;
+}
+
+//A channel 0 reading at gain0 corrected for MeasureRes, see CalData.res
+int PGA::calResApply(int val)
+{
+	long v;
+	
+	if(!cal.resDone) return calOffset(0, gain0, val);
+	v = calApply(0, gain0, val) - (1 << osBits);
+	v += (v * cal.res) >> 16;
+	return v + (1 << osBits);
+}
+
+void PGA::calZero(uint8_t ch)
+{
+	uint8_t *gn = ch ? &gain1 : &gain0;
+	int val;
+	
+	for(uint8_t g = 0; g < 8; g++)
 	{
-		if(gain0 > 0)
-		{
-			SetPGA(--gain0, 0);
-			//Serial.print("New gain: ");
-			//Serial.println(gains[gain]);
-		}
-		else
-		{//Overflow
-			return -1;
-		}
+		val = calRead(ch, g);
+		if(val >= 0) cal.e[ch][g].off = val - (1 << ADC_OS_MAX);
 	}
-	//else if(abs(val) < gainswitch[gain]) //I have room to measure this with a higher gain, better accuracy
-	else if(val < gainswitch[gain0]) //I have room to measure this with a higher gain, better accuracy
-	{//Increase gain
-		if(gain < 7) //Shouldn't need this
-		{
-			SetPGA(++gain0, 0);
-			//Serial.print("New gain: ");
-			//Serial.println(gains[gain]);
-		}
+	adcGain(ch, *gn);
+}
+
+uint8_t PGA::calRef(uint8_t ch, long ref)
+{
+	uint8_t *gn = ch ? &gain1 : &gain0;
+	uint8_t done = 0;
+	long want, got;
+	int val;
+	
+	if((ref <= 0) || (ref > (ch ? CAL_IMAX : CAL_VMAX))) return 0; //the products below would overflow
+	for(uint8_t g = 0; g < 8; g++)
+	{
+		val = calRead(ch, g);
+		if((val < 0) || ((val >> ADC_OS_MAX) >= ADC_CLIP)) continue;
+		got = val - cal.e[ch][g].off - (1 << ADC_OS_MAX); //steps above zero
+		if((got >> ADC_OS_MAX) < CAL_MIN) continue;
+		//what the nominal parts would read, MeasureVoltage/Current backwards
+		if(ch == 0) want = (ref * gains[g] << ADC_OS_MAX) / (2L * Vdiv);
+		else want = (ref * R3 * gains[g] * 5L << ADC_OS_MAX) / Vdiv;
+		//off by half or more is a wrong reference, not a gain error. Inside
+		//that want is under 1.5 full scales and the shift can't overflow.
+		if((want <= (got >> 1)) || (want >= got + (got >> 1))) continue;
+		cal.e[ch][g].corr = (want << 16) / got - 65536;
+		done |= 1 << g;
 	}
-	else
+	cal.done[ch] |= done;
+	adcGain(ch, *gn);
+	return done;
+}
+
+uint8_t PGA::calRes(long mohm)
+{
+	long want, got;
+	int val;
+	uint8_t g = 8;
+	
+	if((mohm <= RES_LEAD) || (mohm > 100000000L)) return 0; //up to 100 kohm
+	//the highest gain calibrated against a voltage that reads it well
+	while(g--)
 	{
-		//Serial.print(val);
-		//Serial.print(" -- ");
-		
-		//outval = val;
-		outval = ((val-1) << 1); //Val at AD input
-		//Serial.print(outval);
-		//Serial.print(" -- ");
-		
-		//outval *= Vdiv;
-		outval /= gains[gain0]; //val at opamp input
-		//Serial.print("volt");
-		//Serial.println(outval); //Original value
-		
-		/*double I = (double)(outval)/(double)(R2);
-		I = ((double)(vref) - (double)(outval)) / I;*/
-		//double I = (double)(((vref-outval)/1000)*(R2/10)) / (double)(outval);
-		double I = (double)((vref-outval)*(R2/10)) / (double)(outval);
-		//Serial.print("ohm");
-		//Serial.print(I);
-		
-		//Serial.println(outval); //Original value
-		return I+50;
-		//delay(450);
+		if(!(cal.done[0] & (1 << g))) continue;
+		val = calRead(0, g);
+		if((val < 0) || ((val >> ADC_OS_MAX) >= ADC_CLIP)) continue;
+		got = val - cal.e[0][g].off - (1 << ADC_OS_MAX);
+		if((got >> ADC_OS_MAX) >= CAL_MIN) break;
 	}
+	adcGain(0, gain0);
+	if(g > 7) return 0;
+	
+	got += (got * cal.e[0][g].corr) >> 16; //what a voltage reading would say
+	//what the nominal parts would read, MeasureRes backwards: vref over
+	//R2 + Rx, in Q15 first so nothing overflows
+	want = (R2 * 100L << 7) / ((R2 * 100L + mohm - RES_LEAD) >> 8);
+	want = ((((long)vref << ADC_OS_MAX) / 2) * want >> 15) * gains[g];
+	if((want <= (got >> 1)) || (want >= got + (got >> 1))) return 0;
+	cal.res = (want << 16) / got - 65536;
+	cal.resDone = 1;
+	return 1;
 }
 
-void PGA::SetPGA(uint8_t G, uint8_t Ch) {
-	channel = Ch;
-	// take the SS pin low to select the chip:
-	digitalWrite(OP_CS, LOW);
-	//  send in the address and value via SPI:
-	SPI.transfer(0x2A);
-	SPI.transfer((G<<4) + Ch);
-	// take the SS pin high to de-select the chip:
-	digitalWrite(OP_CS, HIGH);
+///SAMPLING ENGINE
+void PGA::adcStart(void)
+{
+	if(adcRunning) return;
+	adcPGA = this;
+	adcSum[0] = 0;
+	adcSum[1] = 0;
+	adcCount[0] = 0;
+	adcCount[1] = 0;
+	adcG[0] = gain0;
+	adcG[1] = gain1;
+	adcReload = 0;
+	adcCh = channel;
+	adcSent = adcG[adcCh];
+	adcLeft = ADC_BURST;
+	adcSettle = ADC_SETTLE;
+	SetPGA(adcSent, adcCh);
+	
+	ADMUX = (OPin - A0) & 0x07; //AREF, like analogReference(EXTERNAL)
+	ADCSRB = _BV(ADTS2) | _BV(ADTS0); //start on Timer1 compare match B
+	ADCSRA |= _BV(ADATE) | _BV(ADIE) | _BV(ADIF); //prescaler left as the core set it
+	
+	TCCR1B = 0;
+	TCCR1A = 0;
+	TCNT1 = 0;
+	OCR1A = (F_CPU / 8 / ADC_RATE) - 1;
+	OCR1B = OCR1A;
+	TIFR1 = _BV(OCF1B);
+	TCCR1B = _BV(WGM12) | _BV(CS11); //CTC on OCR1A, clk/8
+	adcRunning = 1;
+}
+
+void PGA::adcStop(void)
+{
+	if(!adcRunning) return;
+	TCCR1B = 0;
+	ADCSRA &= ~(_BV(ADATE) | _BV(ADIE));
+	while(ADCSRA & _BV(ADSC)); //let the last conversion end
+	adcRunning = 0;
+}
+
+void PGA::adcGain(uint8_t Ch, uint8_t G)
+{
+	uint8_t sreg = SREG;
+	cli();
+	adcG[Ch] = G;
+	if(Ch == adcCh) adcReload = 1;
+	adcSum[Ch] = 0;
+	adcCount[Ch] = 0;
+	SREG = sreg;
+}
+
+ISR(ADC_vect)
+{
+	uint16_t v = ADC;
+	
+	TIFR1 = _BV(OCF1B); //the next compare match only triggers with the flag clear
+	
+	if(adcSettle) adcSettle--;
+	else if((adcSent == adcG[adcCh]) && (adcCount[adcCh] != 0xFFFF)) //not taken before a gain change
+	{
+		adcSum[adcCh] += v;
+		adcCount[adcCh]++;
+	}
+	
+	if(adcLeft) adcLeft--;
+	if(adcLeft && !adcReload) return;
+	//PGA writes wait for a free bus, meanwhile the channel keeps its samples
+	if(SPIowner != BUS_FREE) return;
+	if(!adcLeft)
+	{
+		adcCh ^= 1;
+		adcLeft = ADC_BURST;
+	}
+	adcSent = adcG[adcCh];
+	adcReload = 0;
+	pgaSend(adcSent, adcCh);
+	adcSettle = ADC_SETTLE;
 }
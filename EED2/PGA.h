@@ -1,4 +1,5 @@
 #include <inttypes.h>
+#include <p3310.h>
 
 // Vin     R1      V      R2      A      R3
 //  L----/\/\/\----+----/\/\/\----+----/\/\/\---- GND
@@ -11,20 +12,109 @@
 #define Vdiv 97 //((R1+R2+R3)/(R2+R3))/10 //108.7
 #define vref 2036
 
+//MeasureRes results besides milliohms
+#define RES_OPEN -2
+#define RES_SHORT -3
+#define RES_LEAD 51000 //mohm on every reading, the +50 and +1 ohm of the old formula
+#define RES_OPEN_STEPS 2 //fewer ADC steps at the highest gain: nothing between the probes
+
+//Sampling engine: Timer1 compare B triggers the ADC on OPin ADC_RATE times a
+//second and the conversion interrupt alternates the PGA between the voltage
+//(0) and current (1) channel every ADC_BURST samples. The first ADC_SETTLE
+//samples after a PGA write are dropped. The interrupt adds the others to a
+//running sum of their channel, as long as they were taken with the gain the
+//channel still wants. While it runs analogRead() can't be used, stop it
+//around GetBtn/GetBatt.
+#define ADC_RATE 2000 //samples per second
+#define ADC_BURST 16
+#define ADC_SETTLE 2
+
+//Autoranging: a reading over RANGE_DOWN lowers the gain, one that would stay
+//under RANGE_UP at a higher gain raises it, straight to the best gain.
+//In between the gain stays. ADC_CLIP and over is saturated.
+#define RANGE_UP 800
+#define RANGE_DOWN 1000
+#define ADC_CLIP 1021
+#define ADC_OVER -2 //clipped at the lowest gain
+#define ADC_FRESH 4 //samples to average after a gain change
+#define ADC_WAIT 30 //ms to wait for them
+#define ADC_CAL 256 //samples a calibration reading averages
+
+//Oversampling: 4^osBits samples are averaged into every reading, adding
+//osBits bits under the 10 of the ADC (the noise dithers them). Each bit
+//costs 4 times the samples: ADC_OS_MAX takes about 70 ms a reading, for
+//calibration; the multimeter frames use fewer.
+#define ADC_OS_MAX 3
+
+//Calibration at PGACalData: CAL_MAGIC, the CalData (lo byte first), then the
+//CRC16 (xmodem) of it. Without it the nominal R1-R3, Vdiv and gains[] are
+//used as they are.
+#define CAL_MAGIC 0xCC
+#define CAL_MIN 100 //ADC steps a reference must read to calibrate a gain with it
+#define CAL_VMAX 200000L //mV, largest reference: full scale at gain 1
+#define CAL_IMAX 2000L //mA
+
+struct CalEntry{
+	int16_t off; //zero reading minus the nominal one step, in 1/2^ADC_OS_MAX steps
+	int16_t corr; //Q16 gain correction, the factor is 1 + corr/65536
+};
+
+struct CalData{
+	CalEntry e[2][8]; //every gain of channel 0, then of channel 1
+	uint8_t done[2]; //bit g set: gain g of the channel has its corr from a reference
+	//The probes reach channel 0 through R2 for resistance, not through the
+	//input divider that the corr of channel 0 also corrects. res (Q16)
+	//takes the divider back out, from a known resistor. Without it
+	//MeasureRes only takes the offsets out.
+	int16_t res;
+	uint8_t resDone;
+};
+
 class PGA
 {
 	private:
-	
+		int adcMean(uint8_t ch, uint16_t n);
+		int rangedRead(uint8_t ch, uint8_t *g);
+		CalData cal;
+		int calOffset(uint8_t ch, uint8_t g, int val);
+		int calApply(uint8_t ch, uint8_t g, int val);
+		int calResApply(int val);
+		int calRead(uint8_t ch, uint8_t g);
 	
 	public:
 	uint8_t (*EEreadbyte)(long);
 	void (*EEreadmem)(long, uint8_t *, long);
 	void (*EEwritemem)(long, uint8_t *, int);
+	EEStream *EEstream; //for reading tables in one go, see p3310.h
 
 	char gain;
+	uint8_t osBits; //0 to ADC_OS_MAX extra bits per reading
 	void init(void);
 	long MeasureCurrent(void);
 	long MeasureVoltage(long Current);
-	double MeasureRes(uint8_t lowMode);
+	long MeasureRes(uint8_t lowMode);
 	void SetPGA(uint8_t G, uint8_t Ch);
+	
+	void adcStart(void); //does nothing if already running
+	void adcStop(void);
+	void adcGain(uint8_t Ch, uint8_t G); //applied by the interrupt when the bus is free
+	
+	//Calibration, see CalEntry. calLoad() runs in init(). For a new one
+	//short the inputs and call calZero() for each channel, then apply a
+	//known voltage (mV, channel 0) or current (mA, channel 1) and call
+	//calRef(): it calibrates the gains that read it between CAL_MIN and
+	//full scale and returns them as a bit mask. Use a few references to
+	//cover every gain, then calSave(). calReset() first drops the old gain
+	//corrections, so the gains no reference reaches stay nominal and
+	//calDone() tells them apart. After the voltages calRes() with a known
+	//resistor (mohm) calibrates the resistance readings, 1 if it could.
+	uint8_t calValid; //1 if loaded from the EEPROM
+	uint8_t calLoad(void);
+	void calSave(void);
+	void calReset(void);
+	uint8_t calDone(uint8_t ch) { return cal.done[ch]; }
+	void calZero(uint8_t ch);
+	uint8_t calRef(uint8_t ch, long ref);
+	uint8_t calRes(long mohm);
+	uint8_t calResDone(void) { return cal.resDone; }
 };
\ No newline at end of file
@@ -213,16 +213,14 @@ void Graph(uint8_t val, uint8_t maxv)
 {
 	//Serial.println(val);
 	val = (maxv / (LCDWIDTH - 6)) * val;
-	phone.lcd_buffer[(LCDWIDTH * 3) + 1] = 0xFF;
-	phone.lcd_buffer[(LCDWIDTH * 3) + 82] = 0xFF;
-	phone.lcd_buffer[(LCDWIDTH * 3) + 2] = 0x81;
-	phone.lcd_buffer[(LCDWIDTH * 3) + 81] = 0x81;
-	for(uint8_t i = 0; i < (LCDWIDTH-6); i++)
-	{
-		if(i < val) phone.lcd_buffer[(LCDWIDTH * 3) + i+3] = 0xBD;
-		else phone.lcd_buffer[(LCDWIDTH * 3) + i+3] = 0x81;
-	}
-	phone.display();
+	if(val > (LCDWIDTH-6)) val = LCDWIDTH-6;
+	phone.fillBytes(3, 1, 1, 0xFF);
+	phone.fillBytes(3, 82, 1, 0xFF);
+	phone.fillBytes(3, 2, 1, 0x81);
+	phone.fillBytes(3, 81, 1, 0x81);
+	phone.fillBytes(3, 3, val, 0xBD);
+	phone.fillBytes(3, 3 + val, (LCDWIDTH-6) - val, 0x81);
+	phone.displayAsync();
 }
 void sendAllCodes() {
 
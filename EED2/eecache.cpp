@@ -0,0 +1,115 @@
+/*
+    1337 3310 tool - a multitool in the form factor of the best phone ever
+	This file caches EEPROM lines in RAM for the readB/readM hooks
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/ 
+
+#include "eecache.h"
+#include <spieeprom.h>
+#include <string.h>
+
+extern SPIEEPROM disk1;
+
+#if EECACHE_LINES > 0
+uint16_t eeHits, eeMisses;
+long cacheTag[EECACHE_LINES]; //address of the line, -1 when empty
+byte cacheData[EECACHE_LINES][EECACHE_LINE];
+uint8_t cacheLRU[EECACHE_LINES]; //line indexes, most recent first
+#endif
+
+void cacheFlush(void)
+{
+#if EECACHE_LINES > 0
+	for(uint8_t i = 0; i < EECACHE_LINES; i++)
+	{
+		cacheTag[i] = -1;
+		cacheLRU[i] = i;
+	}
+#endif
+}
+
+#if EECACHE_LINES > 0
+//Cached copy of the line starting at addr, read on a miss
+static byte *cacheLine(long addr)
+{
+	uint8_t i, e;
+	
+	for(i = 0; i < EECACHE_LINES; i++)
+		if(cacheTag[cacheLRU[i]] == addr) break;
+	if(i < EECACHE_LINES) eeHits++;
+	else
+	{
+		eeMisses++;
+		i = EECACHE_LINES - 1; //reuse the least recent
+		e = cacheLRU[i];
+		busTake(BUS_EE);
+		disk1.read_mem(addr, cacheData[e], EECACHE_LINE);
+		busRelease();
+		cacheTag[e] = addr;
+	}
+	e = cacheLRU[i];
+	for(; i > 0; i--) cacheLRU[i] = cacheLRU[i - 1];
+	cacheLRU[0] = e;
+	return cacheData[e];
+}
+#endif
+
+byte readB(long addr)
+{
+#if EECACHE_LINES > 0
+	return cacheLine(addr & ~(long)(EECACHE_LINE - 1))[addr & (EECACHE_LINE - 1)];
+#else
+	byte b;
+	busTake(BUS_EE);
+	b = disk1.read_byte(addr);
+	busRelease();
+	return b;
+#endif
+}
+void readM(long addr, byte * buff, long size)
+{
+#if EECACHE_LINES > 0
+	uint8_t off, n;
+	
+	if(size < EECACHE_LINE)
+	{
+		while(size > 0)
+		{
+			off = addr & (EECACHE_LINE - 1);
+			n = EECACHE_LINE - off;
+			if(n > size) n = size;
+			memcpy(buff, cacheLine(addr - off) + off, n);
+			addr += n;
+			buff += n;
+			size -= n;
+		}
+		return;
+	}
+#endif
+	busTake(BUS_EE);
+	disk1.read_mem(addr, buff, size);
+	busRelease();
+}
+void writeM(long addr, byte * buff, int size)
+{
+#if EECACHE_LINES > 0
+	for(uint8_t i = 0; i < EECACHE_LINES; i++) //drop the lines it touches
+		if((cacheTag[i] != -1) && (cacheTag[i] < addr + size) && (cacheTag[i] + EECACHE_LINE > addr))
+			cacheTag[i] = -1;
+#endif
+	busTake(BUS_EE);
+	disk1.write(addr, buff, size);
+	busRelease();
+}
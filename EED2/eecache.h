@@ -0,0 +1,43 @@
+/*
+    1337 3310 tool - a multitool in the form factor of the best phone ever
+	EEPROM access for P3310 and PGA, through a read cache, see eecache.cpp
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/ 
+
+#include <p3310.h>
+
+//EEPROM read cache in front of readB/readM, 0 lines disables it.
+//Reads of a line or more (bitmap chunks, screens) go straight to the chip
+//so they don't push out fonts and calibration data.
+//Off: on the multimeter page 4 lines of 16 hit 31% of the glyph reads and
+//clock more bytes than they save (379 a frame against 297 uncached), 8 of
+//32 are needed to win. The glyph cache in p3310.h is the one to grow.
+//tools/emu/variants.sh builds it with 8 lines.
+#ifndef EECACHE_LINES
+#define EECACHE_LINES 0
+#endif
+#ifndef EECACHE_LINE
+#define EECACHE_LINE 16 //bytes, power of 2
+#endif
+
+//The hooks given to phone and pga1, on disk1
+byte readB(long addr);
+void readM(long addr, byte * buff, long size);
+void writeM(long addr, byte * buff, int size);
+void cacheFlush(void); //call after writing the EEPROM around writeM
+
+#if EECACHE_LINES > 0
+extern uint16_t eeHits, eeMisses; //line lookups, for tuning the sizes above
+#endif
@@ -0,0 +1,310 @@
+/*
+    1337 3310 tool - a multitool in the form factor of the best phone ever
+	This file programs the asset EEPROM over serial, talking to tools/eeflash
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/ 
+
+#include "eeflash.h"
+#include "eecache.h"
+#include <SPI.h>
+#include <spieeprom.h>
+#include <util/crc16.h>
+
+extern P3310 phone;
+extern SPIEEPROM disk1;
+extern EEStream eeStream;
+extern void assetsLoad(void);
+
+//Payload of the frame in and out. No RAM of its own: the session owns the
+//LCD and only draws in banks 2-3, so it borrows the last two banks.
+#define eefBuf (phone.lcd_buffer + (4 * LCDWIDTH))
+#define EEF_BUF (EEF_CHUNK + 6)
+
+//Write in progress, see eefWrite()
+static long eefNext = -1; //address after its last byte, -1 when none
+static long eefStart;
+static uint16_t eefSum; //CRC16 of the bytes sent
+static uint8_t eefPaged; //0 until a full page was read back, 2 if it failed
+
+//Next serial byte, -1 after EEF_TIMEOUT ms of silence
+static int eefGet(void)
+{
+	unsigned long t = millis();
+	while(!Serial.available())
+		if((millis() - t) > EEF_TIMEOUT) return -1;
+	return Serial.read();
+}
+
+static void eefSend(uint8_t cmd, uint8_t *d, uint8_t len)
+{
+	uint16_t crc = 0;
+	
+	crc = _crc_xmodem_update(crc, cmd);
+	crc = _crc_xmodem_update(crc, len);
+	Serial.write(EEF_SOF);
+	Serial.write(cmd);
+	Serial.write(len);
+	for(uint8_t i = 0; i < len; i++)
+	{
+		crc = _crc_xmodem_update(crc, d[i]);
+		Serial.write(d[i]);
+	}
+	Serial.write(crc & 0xFF);
+	Serial.write(crc >> 8);
+}
+
+static void eefNak(uint8_t err)
+{
+	eefSend(EEF_NAK, &err, 1);
+}
+
+//Reads the rest of a frame after EEF_SOF. Returns the command, 0 on timeout
+//or a damaged frame (already NAKed).
+static uint8_t eefFrame(uint8_t *len)
+{
+	int c, cmd, n;
+	uint16_t crc = 0;
+	
+	if((cmd = eefGet()) < 0) return 0;
+	if((n = eefGet()) < 0) return 0;
+	crc = _crc_xmodem_update(crc, cmd);
+	crc = _crc_xmodem_update(crc, n);
+	for(uint8_t i = 0; i < n; i++)
+	{
+		if((c = eefGet()) < 0) return 0;
+		if(i < EEF_BUF) eefBuf[i] = c;
+		crc = _crc_xmodem_update(crc, c);
+	}
+	if((c = eefGet()) < 0) return 0;
+	crc ^= c;
+	if((c = eefGet()) < 0) return 0;
+	crc ^= c << 8;
+	if(crc || (n > EEF_BUF))
+	{
+		eefNak(EEF_EFRAME);
+		return 0;
+	}
+	*len = n;
+	return cmd;
+}
+
+//Skips to the next frame, 0 on timeout
+static uint8_t eefSync(void)
+{
+	int c;
+	
+	while((c = eefGet()) >= 0)
+		if(c == EEF_SOF) return 1;
+	return 0;
+}
+
+static long eefLong(uint8_t *p)
+{
+	return p[0] | ((long)p[1] << 8) | ((long)p[2] << 16);
+}
+
+static void eefWaitWIP(void)
+{
+	busTake(BUS_EE);
+	while(disk1.isWIP());
+	busRelease();
+}
+
+//Ends the write in progress: the chip programs its page now, while the
+//next frame comes in over serial
+static void eefClose(void)
+{
+	if(eefNext < 0) return;
+	digitalWrite(SLAVESELECT, HIGH);
+	busRelease();
+	eefNext = -1;
+}
+
+//Chunks go into the chip's page buffer as they come. A chunk that goes on
+//where the last one stopped keeps the write open, so each page is
+//programmed once, when it fills up or something else comes. The bus stays
+//taken meanwhile, nothing else runs during a session.
+static void eefWrite(long addr, uint8_t *d, uint8_t n)
+{
+	if(addr != eefNext)
+	{
+		eefClose();
+		busTake(BUS_EE);
+		while(disk1.isWIP()); //previous page
+		disk1.start_write();
+		disk1.send_address(addr);
+		eefStart = addr;
+		eefSum = 0;
+	}
+	eefNext = addr + n;
+	while(n--)
+	{
+		eefSum = _crc_xmodem_update(eefSum, *d);
+		SPI.transfer(*d++);
+	}
+	if((eefNext % EEF_PAGE) == 0) eefClose();
+}
+
+static uint16_t eefCRC(long addr, long len)
+{
+	uint16_t crc = 0;
+	
+	eefClose();
+	eefWaitWIP();
+	eeStream.open(addr);
+	while(len--) crc = _crc_xmodem_update(crc, eeStream.read());
+	eeStream.close();
+	return crc;
+}
+
+//Two CRCs of each of n pages, so the host can tell which ones changed
+static void eefHash(long addr, uint8_t n)
+{
+	uint16_t x, c;
+	uint8_t b, *p = eefBuf;
+	
+	eefClose();
+	eefWaitWIP();
+	eeStream.open(addr);
+	while(n--)
+	{
+		x = 0;
+		c = 0xFFFF;
+		for(uint16_t i = 0; i < EEF_PAGE; i++)
+		{
+			b = eeStream.read();
+			x = _crc_xmodem_update(x, b);
+			c = _crc_ccitt_update(c, b);
+		}
+		*p++ = x & 0xFF;
+		*p++ = x >> 8;
+		*p++ = c & 0xFF;
+		*p++ = c >> 8;
+	}
+	eeStream.close();
+}
+
+static void eefSession(void)
+{
+	uint8_t cmd, len;
+	long addr, n;
+	uint16_t crc;
+	
+	phone.clearDisplay();
+	phone.fillRect(0, 20, LCDWIDTH, 8); //fonts may be half written, no text
+	phone.display();
+	eefPaged = 0;
+	
+	do
+	{
+		cmd = eefFrame(&len);
+		addr = eefLong(eefBuf);
+		switch(cmd)
+		{
+			case 0: break;
+			case EEF_INFO:
+				eefBuf[0] = EEF_VERSION;
+				eefBuf[1] = EEF_CHUNK;
+				eefBuf[2] = EEF_PAGE & 0xFF;
+				eefBuf[3] = EEF_PAGE >> 8;
+				n = EEF_END_ASSETS;
+				eefBuf[4] = n & 0xFF;
+				eefBuf[5] = (n >> 8) & 0xFF;
+				eefBuf[6] = n >> 16;
+				eefSend(EEF_INFO, eefBuf, 7);
+				break;
+			case EEF_WRITE:
+				n = len - 3;
+				if((len < 4) || (((addr % EEF_PAGE) + n) > EEF_PAGE) || ((addr + n) > EEF_END_ASSETS))
+				{
+					eefNak(EEF_EPAGE);
+					break;
+				}
+				if(eefPaged == 2)
+				{
+					eefNak(EEF_ESIZE);
+					break;
+				}
+				eefWrite(addr, eefBuf + 3, n);
+				//the first whole page of a session is read back: a chip with
+				//smaller pages wraps around inside it
+				if(!eefPaged && (eefNext < 0) && !(eefStart % EEF_PAGE) && ((addr + n - eefStart) == EEF_PAGE))
+					eefPaged = (eefCRC(eefStart, EEF_PAGE) == eefSum) ? 1 : 2;
+				if(eefPaged == 2) eefNak(EEF_ESIZE);
+				else eefSend(EEF_ACK, 0, 0);
+				break;
+			case EEF_READ:
+				n = eefBuf[3];
+				if((len != 4) || (n > EEF_CHUNK))
+				{
+					eefNak(EEF_EFRAME);
+					break;
+				}
+				eefClose();
+				eefWaitWIP();
+				eeStream.open(addr);
+				eeStream.read(eefBuf, n);
+				eeStream.close();
+				eefSend(EEF_READ, eefBuf, n);
+				break;
+			case EEF_CRC:
+				if(len != 6)
+				{
+					eefNak(EEF_EFRAME);
+					break;
+				}
+				crc = eefCRC(addr, eefLong(eefBuf + 3));
+				eefBuf[0] = crc & 0xFF;
+				eefBuf[1] = crc >> 8;
+				eefSend(EEF_CRC, eefBuf, 2);
+				break;
+			case EEF_HASH:
+				n = eefBuf[3];
+				if((len != 4) || (n > EEF_CHUNK / 4) || (addr % EEF_PAGE))
+				{
+					eefNak(EEF_EFRAME);
+					break;
+				}
+				eefHash(addr, n);
+				eefSend(EEF_HASH, eefBuf, n * 4);
+				break;
+			case EEF_END:
+				eefClose();
+				eefWaitWIP();
+				eefSend(EEF_ACK, 0, 0);
+				break;
+			default:
+				eefNak(EEF_ECMD);
+		}
+	} while((cmd != EEF_END) && eefSync());
+	
+	//the assets may have changed under the caches
+	eefClose();
+	eefWaitWIP();
+	cacheFlush();
+	phone.glyphFlush();
+	assetsLoad();
+	phone.clearDisplay();
+	phone.display();
+}
+
+//Call from loop(): a frame on serial begins a programming session, which
+//runs until EEF_END or EEF_TIMEOUT of silence
+void eeflashPoll(void)
+{
+	if(!Serial.available()) return;
+	if(Serial.read() != EEF_SOF) return; //debug chatter from the host side
+	eefSession();
+}
@@ -0,0 +1,51 @@
+/*
+    1337 3310 tool - a multitool in the form factor of the best phone ever
+	EEPROM programming over serial, see eeflash.cpp and tools/eeflash
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/ 
+
+#include <p3310.h>
+
+//250000 is exact at 16MHz (and 8MHz with U2X), unlike 115200
+#define EEF_BAUD 250000
+
+//Frame: EEF_SOF, command, payload length, payload, CRC16 (xmodem, low byte
+//first) of command, length and payload. Addresses and lengths are 3 bytes,
+//low byte first.
+#define EEF_SOF 0x7E
+#define EEF_INFO 'I' //-> version, chunk, page size (2), asset space (3)
+#define EEF_WRITE 'W' //addr, data. Inside one page. Acked before the page is programmed.
+#define EEF_READ 'R' //addr, length (1) -> data
+#define EEF_CRC 'C' //addr, length -> CRC16 of that range
+#define EEF_HASH 'H' //page aligned addr, count (1) -> xmodem and ccitt CRC16 of each page
+#define EEF_END 'E' //waits for the last write and leaves
+#define EEF_ACK 'A'
+#define EEF_NAK 'N' //-> error code
+
+#define EEF_EFRAME 1 //bad CRC or length
+#define EEF_EPAGE 2 //write crosses a page or the end of the chip
+#define EEF_ECMD 3
+#define EEF_ESIZE 4 //the first full page didn't read back, the chip's pages are smaller than EEF_PAGE
+
+#define EEF_VERSION 2
+#define EEF_CHUNK 128 //largest write or read payload, a frame length is one byte
+#define EEF_PAGE 256 //EEPROM page: 256 on the 24 bit address parts (25LC1024, M95M01)
+#if (EEF_PAGE % EEF_CHUNK) || (EEF_CHUNK > 255 - 3)
+#error EEF_CHUNK must divide EEF_PAGE and fit a frame
+#endif
+#define EEF_TIMEOUT 1000 //ms without frames ends the session
+#define EEF_END_ASSETS (PGACalData) //calibration lives past here, never written
+
+extern void eeflashPoll(void);
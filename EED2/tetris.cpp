@@ -191,10 +191,11 @@ void setupT()
 }
 
 long delBtnt;
+FrameClock tframes;
 //**********************************************************************************************************************************************************  
 void loopT() 
 {
-  delay(30);
+	if(!phone.frameDue(&tframes, 30)) return;
   
 	if(!gameoverFlag)
 	{		
@@ -239,6 +240,7 @@ void loopT()
 			}
 		}
 	}
+	phone.frameEnd(&tframes);
 }
 
 //**********************************************************************************************************************************************************  
@@ -1093,33 +1095,12 @@ void LEDRefresh()
 	
 	phone.clearDisplay();
 	
-	for(i = 0; i < 6; i++)
-	{
-		phone.lcd_buffer[LCDWIDTH * i] = 0xFF;
-		phone.lcd_buffer[(LCDWIDTH * i) + 26] = 0xFF;
-	}
+	phone.vLine(0, 0, LCDHEIGHT);
+	phone.vLine(26, 0, LCDHEIGHT);
 	for(i = 0; i < 8; i++)
 		for(k = 0; k < 16; k++)
 			if(disp[i][k]) 
-			{
-				phone.SetPx((i*3)+2, (k*3)+1);
-				phone.SetPx((i*3)+3, (k*3)+1);
-
-				phone.SetPx((i*3)+3, (k*3)+2);
-				phone.SetPx((i*3)+2, (k*3)+2);
-
-				/*phone.SetPx((i*3)+1, (k*3));
-				phone.SetPx((i*3)+2, (k*3));
-				phone.SetPx((i*3)+3, (k*3));
-				
-				phone.SetPx((i*3)+2, (k*3)+1);
-				phone.SetPx((i*3)+1, (k*3)+1);
-				phone.SetPx((i*3)+1, (k*3)+2);
-				
-				phone.SetPx((i*3)+3, (k*3)+2);
-				phone.SetPx((i*3)+3, (k*3)+1);
-				phone.SetPx((i*3)+2, (k*3)+2);*/
-			}
+				phone.fillRect((i*3)+2, (k*3)+1, 2, 2);
 	phone.display();
 	
   
@@ -1,8 +1,6 @@
 /*
-  Library to handle various phone functions.
-  Includes a lightweight font and bitmap library and
-  LCD drivers based on Adafruit_PCD8544
- 
+  Part of the library to handle various phone functions.
+
     Copyright (C) 2015 Cristiano Griletti
 
     This program is free software: you can redistribute it and/or modify
@@ -16,9 +14,20 @@
 
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
-*/ 
+*/
+
+//Map of the assets in EEPROM, generated by tools/assetc from assets.txt. Do not edit.
+//Bitmap and animation offsets are from idx_zbmp.
+
+#ifndef BMP_H_
+#define BMP_H_
+
+#define idx_font_l 0
+#define idx_font_sb 957
+#define idx_font_sp 1443
+#define idx_zbmp 1855
+#define EEimage 31798 //bytes used
 
-//Map of bitmaps in memory
 #define bmp330 0
 #define bmp331 506
 #define bmp332 1012
@@ -205,3 +214,196 @@
 #define bmp365 25301
 #define bmp366 25807
 #define bmp367 26313
+#define bootani 26819
+#define bootani_FRAMES 6 //animation
+
+//Directory ids for P3310::asset()
+#define ASSET_bmp330 0x54EB
+#define ASSET_bmp331 0x44CA
+#define ASSET_bmp332 0x74A9
+#define ASSET_bmp333 0x6488
+#define ASSET_bmp334 0x146F
+#define ASSET_bmp335 0x044E
+#define ASSET_bmp007 0x280F
+#define ASSET_bmp015 0x3B7C
+#define ASSET_bmp079 0x5056
+#define ASSET_bmp080 0xD141
+#define ASSET_bmp085 0x81E4
+#define ASSET_bmp086 0xB187
+#define ASSET_bmp087 0xA1A6
+#define ASSET_bmp088 0x5049
+#define ASSET_bmp089 0x4068
+#define ASSET_bmp090 0xE270
+#define ASSET_bmp091 0xF251
+#define ASSET_bmp092 0xC232
+#define ASSET_bmp093 0xD213
+#define ASSET_bmp094 0xA2F4
+#define ASSET_bmp095 0xB2D5
+#define ASSET_bmp096 0x82B6
+#define ASSET_bmp097 0x9297
+#define ASSET_bmp098 0x6378
+#define ASSET_bmp099 0x7359
+#define ASSET_bmp100 0x6FD8
+#define ASSET_bmp101 0x7FF9
+#define ASSET_bmp102 0x4F9A
+#define ASSET_bmp103 0x5FBB
+#define ASSET_bmp104 0x2F5C
+#define ASSET_bmp105 0x3F7D
+#define ASSET_bmp106 0x0F1E
+#define ASSET_bmp107 0x1F3F
+#define ASSET_bmp108 0xEED0
+#define ASSET_bmp109 0xFEF1
+#define ASSET_bmp110 0x5CE9
+#define ASSET_bmp111 0x4CC8
+#define ASSET_bmp112 0x7CAB
+#define ASSET_bmp113 0x6C8A
+#define ASSET_bmp114 0x1C6D
+#define ASSET_bmp115 0x0C4C
+#define ASSET_bmp116 0x3C2F
+#define ASSET_bmp117 0x2C0E
+#define ASSET_bmp118 0xDDE1
+#define ASSET_bmp119 0xCDC0
+#define ASSET_bmp120 0x09BA
+#define ASSET_bmp121 0x199B
+#define ASSET_bmp122 0x29F8
+#define ASSET_bmp123 0x39D9
+#define ASSET_bmp124 0x493E
+#define ASSET_bmp125 0x591F
+#define ASSET_bmp126 0x697C
+#define ASSET_bmp127 0x795D
+#define ASSET_bmp128 0x88B2
+#define ASSET_bmp129 0x9893
+#define ASSET_bmp130 0x3A8B
+#define ASSET_bmp131 0x2AAA
+#define ASSET_bmp132 0x1AC9
+#define ASSET_bmp133 0x0AE8
+#define ASSET_bmp134 0x7A0F
+#define ASSET_bmp135 0x6A2E
+#define ASSET_bmp136 0x5A4D
+#define ASSET_bmp137 0x4A6C
+#define ASSET_bmp138 0xBB83
+#define ASSET_bmp139 0xABA2
+#define ASSET_bmp140 0xA31C
+#define ASSET_bmp141 0xB33D
+#define ASSET_bmp142 0x835E
+#define ASSET_bmp143 0x937F
+#define ASSET_bmp144 0xE398
+#define ASSET_bmp145 0xF3B9
+#define ASSET_bmp146 0xC3DA
+#define ASSET_bmp147 0xD3FB
+#define ASSET_bmp148 0x2214
+#define ASSET_bmp149 0x3235
+#define ASSET_bmp150 0x902D
+#define ASSET_bmp151 0x800C
+#define ASSET_bmp152 0xB06F
+#define ASSET_bmp153 0xA04E
+#define ASSET_bmp154 0xD0A9
+#define ASSET_bmp155 0xC088
+#define ASSET_bmp156 0xF0EB
+#define ASSET_bmp157 0xE0CA
+#define ASSET_bmp158 0x1125
+#define ASSET_bmp159 0x0104
+#define ASSET_bmp160 0xC57E
+#define ASSET_bmp161 0xD55F
+#define ASSET_bmp162 0xE53C
+#define ASSET_bmp163 0xF51D
+#define ASSET_bmp164 0x85FA
+#define ASSET_bmp165 0x95DB
+#define ASSET_bmp166 0xA5B8
+#define ASSET_bmp167 0xB599
+#define ASSET_bmp168 0x4476
+#define ASSET_bmp169 0x5457
+#define ASSET_bmp170 0xF64F
+#define ASSET_bmp171 0xE66E
+#define ASSET_bmp172 0xD60D
+#define ASSET_bmp173 0xC62C
+#define ASSET_bmp174 0xB6CB
+#define ASSET_bmp175 0xA6EA
+#define ASSET_bmp176 0x9689
+#define ASSET_bmp177 0x86A8
+#define ASSET_bmp178 0x7747
+#define ASSET_bmp179 0x6766
+#define ASSET_bmp180 0xE671
+#define ASSET_bmp181 0xF650
+#define ASSET_bmp182 0xC633
+#define ASSET_bmp183 0xD612
+#define ASSET_bmp184 0xA6F5
+#define ASSET_bmp185 0xB6D4
+#define ASSET_bmp186 0x86B7
+#define ASSET_bmp187 0x9696
+#define ASSET_bmp188 0x6779
+#define ASSET_bmp189 0x7758
+#define ASSET_bmp190 0xD540
+#define ASSET_bmp191 0xC561
+#define ASSET_bmp192 0xF502
+#define ASSET_bmp193 0xE523
+#define ASSET_bmp194 0x95C4
+#define ASSET_bmp195 0x85E5
+#define ASSET_bmp196 0xB586
+#define ASSET_bmp197 0xA5A7
+#define ASSET_bmp198 0x5448
+#define ASSET_bmp199 0x4469
+#define ASSET_bmp200 0x3688
+#define ASSET_bmp201 0x26A9
+#define ASSET_bmp202 0x16CA
+#define ASSET_bmp203 0x06EB
+#define ASSET_bmp204 0x760C
+#define ASSET_bmp205 0x662D
+#define ASSET_bmp206 0x564E
+#define ASSET_bmp207 0x466F
+#define ASSET_bmp208 0xB780
+#define ASSET_bmp209 0xA7A1
+#define ASSET_bmp210 0x05B9
+#define ASSET_bmp211 0x1598
+#define ASSET_bmp212 0x25FB
+#define ASSET_bmp213 0x35DA
+#define ASSET_bmp214 0x453D
+#define ASSET_bmp215 0x551C
+#define ASSET_bmp216 0x657F
+#define ASSET_bmp226 0x302C
+#define ASSET_bmp227 0x200D
+#define ASSET_bmp229 0xC1C3
+#define ASSET_bmp230 0x63DB
+#define ASSET_bmp231 0x73FA
+#define ASSET_bmp232 0x4399
+#define ASSET_bmp233 0x53B8
+#define ASSET_bmp234 0x235F
+#define ASSET_bmp235 0x337E
+#define ASSET_bmp236 0x031D
+#define ASSET_bmp237 0x133C
+#define ASSET_bmp238 0xE2D3
+#define ASSET_bmp239 0xF2F2
+#define ASSET_bmp240 0xFA4C
+#define ASSET_bmp241 0xEA6D
+#define ASSET_bmp242 0xDA0E
+#define ASSET_bmp243 0xCA2F
+#define ASSET_bmp244 0xBAC8
+#define ASSET_bmp245 0xAAE9
+#define ASSET_bmp246 0x9A8A
+#define ASSET_bmp247 0x8AAB
+#define ASSET_bmp248 0x7B44
+#define ASSET_bmp249 0x6B65
+#define ASSET_bmp250 0xC97D
+#define ASSET_bmp251 0xD95C
+#define ASSET_bmp252 0xE93F
+#define ASSET_bmp253 0xF91E
+#define ASSET_bmp254 0x89F9
+#define ASSET_bmp255 0x99D8
+#define ASSET_bmp256 0xA9BB
+#define ASSET_bmp257 0xB99A
+#define ASSET_bmp258 0x4875
+#define ASSET_bmp259 0x5854
+#define ASSET_bmp260 0x9C2E
+#define ASSET_bmp261 0x8C0F
+#define ASSET_bmp262 0xBC6C
+#define ASSET_bmp263 0xAC4D
+#define ASSET_bmp264 0xDCAA
+#define ASSET_bmpogo 0x1625
+#define ASSET_bmp363 0x9B7D
+#define ASSET_bmp364 0xEB9A
+#define ASSET_bmp365 0xFBBB
+#define ASSET_bmp366 0xCBD8
+#define ASSET_bmp367 0xDBF9
+#define ASSET_bootani 0xC4B2
+
+#endif
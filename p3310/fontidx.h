@@ -0,0 +1,80 @@
+/*
+  Part of the library to handle various phone functions.
+
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Font character index, generated by tools/assetc. Do not edit.
+//EEPROM address of the width byte and width in columns of every char
+//from 0x20 to 0x7F; width 0 means the font doesn't have it.
+
+#ifndef FONTIDX_H_
+#define FONTIDX_H_
+
+#define FONT_FIRST 0x20
+#define FONT_CHARS 0x60
+
+struct FontChar{
+	uint16_t off;
+	uint8_t wid;
+};
+
+//0: small/bold, 1: small/plain, 2: large
+const FontChar PROGMEM fontIdx[3][FONT_CHARS] = {
+{
+	{957, 2}, {960, 2}, {963, 3}, {967, 5}, {973, 5}, {979, 6}, {986, 6}, {993, 1}, 
+	{995, 3}, {999, 3}, {1003, 5}, {1009, 5}, {1015, 2}, {1018, 4}, {1023, 2}, {1026, 3}, 
+	{1030, 5}, {1036, 5}, {1042, 5}, {1048, 5}, {1054, 5}, {1060, 5}, {1066, 5}, {1072, 5}, 
+	{1078, 5}, {1084, 5}, {1090, 2}, {1093, 2}, {1096, 4}, {1101, 4}, {1106, 4}, {1111, 5}, 
+	{1117, 6}, {1124, 5}, {1130, 5}, {1136, 5}, {1142, 5}, {1148, 5}, {1154, 5}, {1160, 5}, 
+	{1166, 5}, {1172, 2}, {1175, 4}, {1180, 6}, {1187, 4}, {1192, 7}, {1200, 6}, {1207, 6}, 
+	{1214, 5}, {1220, 6}, {1227, 5}, {1233, 4}, {1238, 6}, {1245, 5}, {1251, 6}, {1258, 7}, 
+	{1266, 6}, {1273, 6}, {1280, 5}, {0, 0}, {1286, 3}, {0, 0}, {0, 0}, {1290, 6}, 
+	{0, 0}, {1297, 5}, {1303, 5}, {1309, 4}, {1314, 5}, {1320, 5}, {1326, 3}, {1330, 5}, 
+	{1336, 5}, {1342, 2}, {1345, 3}, {1349, 5}, {1355, 2}, {1358, 8}, {1367, 5}, {1373, 5}, 
+	{1379, 5}, {1385, 5}, {1391, 4}, {1396, 4}, {1401, 3}, {1405, 5}, {1411, 5}, {1417, 7}, 
+	{1425, 5}, {1431, 5}, {1437, 5}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, 
+},
+{
+	{1443, 2}, {1446, 1}, {1448, 3}, {1452, 5}, {1458, 4}, {1463, 4}, {1468, 5}, {1474, 1}, 
+	{1476, 2}, {1479, 2}, {1482, 5}, {1488, 5}, {1494, 2}, {1497, 4}, {1502, 1}, {1504, 3}, 
+	{1508, 4}, {1513, 4}, {1518, 4}, {1523, 4}, {1528, 4}, {1533, 4}, {1538, 4}, {1543, 4}, 
+	{1548, 4}, {1553, 4}, {1558, 2}, {1561, 2}, {1564, 4}, {1569, 4}, {1574, 4}, {1579, 4}, 
+	{1584, 5}, {1590, 4}, {1595, 4}, {1600, 4}, {1605, 4}, {1610, 4}, {1615, 4}, {1620, 4}, 
+	{1625, 4}, {1630, 1}, {1632, 3}, {1636, 4}, {1641, 4}, {1646, 5}, {1652, 5}, {1658, 5}, 
+	{1664, 4}, {1669, 5}, {1675, 4}, {1680, 4}, {1685, 5}, {1691, 4}, {1696, 5}, {1702, 7}, 
+	{1710, 5}, {1716, 5}, {1722, 4}, {0, 0}, {1727, 3}, {0, 0}, {0, 0}, {1731, 5}, 
+	{0, 0}, {1737, 4}, {1742, 4}, {1747, 3}, {1751, 4}, {1756, 4}, {1761, 2}, {1764, 4}, 
+	{1769, 4}, {1774, 1}, {1776, 2}, {1779, 4}, {1784, 1}, {1786, 5}, {1792, 4}, {1797, 4}, 
+	{1802, 4}, {1807, 4}, {1812, 3}, {1816, 3}, {1820, 2}, {1823, 4}, {1828, 5}, {1834, 5}, 
+	{1840, 4}, {1845, 4}, {1850, 4}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, 
+},
+{
+	{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, 
+	{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, 
+	{0, 7}, {15, 7}, {30, 7}, {45, 7}, {60, 7}, {75, 7}, {90, 7}, {105, 7}, 
+	{120, 7}, {135, 7}, {150, 3}, {157, 3}, {164, 5}, {175, 5}, {186, 5}, {197, 6}, 
+	{210, 9}, {229, 7}, {244, 7}, {259, 6}, {272, 7}, {287, 7}, {302, 7}, {317, 7}, 
+	{332, 7}, {347, 2}, {352, 5}, {363, 8}, {380, 6}, {393, 9}, {412, 7}, {427, 8}, 
+	{444, 7}, {459, 8}, {476, 8}, {493, 6}, {506, 6}, {519, 7}, {534, 8}, {551, 10}, 
+	{572, 7}, {587, 8}, {604, 7}, {0, 0}, {619, 4}, {0, 0}, {0, 0}, {628, 8}, 
+	{0, 0}, {645, 6}, {658, 6}, {671, 5}, {682, 6}, {695, 6}, {708, 4}, {717, 6}, 
+	{730, 6}, {743, 2}, {748, 3}, {755, 6}, {768, 2}, {773, 8}, {790, 6}, {803, 6}, 
+	{816, 6}, {829, 6}, {842, 5}, {853, 5}, {864, 4}, {873, 6}, {886, 6}, {899, 9}, 
+	{918, 6}, {931, 6}, {944, 6}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, 
+},
+};
+
+#endif
@@ -26,9 +26,36 @@
 #include <inttypes.h>
 #include "Arduino.h"
 #include <avr/pgmspace.h>
+#include <util/crc16.h>
 
 //P3310::P3310(){}
 
+///SPI BUS
+volatile uint8_t SPIowner = BUS_FREE;
+P3310 *asyncLCD; //instance feeding the SPI interrupt
+
+void busTake(uint8_t who)
+{
+	uint8_t sreg;
+	while(1)
+	{
+		sreg = SREG;
+		cli();
+		if(SPIowner == BUS_FREE)
+		{
+			SPIowner = who;
+			SREG = sreg;
+			return;
+		}
+		SREG = sreg;
+	}
+}
+
+void busRelease(void)
+{
+	SPIowner = BUS_FREE;
+}
+
 
 void P3310::IOinit()
 {
@@ -105,6 +132,7 @@ void P3310::LCDinit(uint8_t contrast, uint8_t bias)
 	_delay_ms(500);
 	digitalWrite(LCD_RES, HIGH);
 	
+	busTake(BUS_LCD);
 	command(PCD8544_FUNCTIONSET | PCD8544_EXTENDEDINSTRUCTION );// get into the EXTENDED mode!
 	command(PCD8544_SETBIAS | bias);							// LCD bias select (4 is optimal?)
 	
@@ -113,8 +141,13 @@ void P3310::LCDinit(uint8_t contrast, uint8_t bias)
 	command( PCD8544_SETVOP | contrast);						// Experimentally determined
 	command(PCD8544_FUNCTIONSET);								// normal mode
 	command(PCD8544_DISPLAYCONTROL | PCD8544_DISPLAYNORMAL);	// Set display to Normal
+	busRelease();
 
 	// Push out pcd8544_buffer to the Display (will show the AFI logo)
+#ifdef LCD_SHADOW
+	shadowValid = 0;
+#endif
+	markAllDirty();
 	display();
 }
 
@@ -136,44 +169,385 @@ void P3310::setContrast(uint8_t val) {
 	if (val > 0x7f) {
 		val = 0x7f;
 	}
+	busTake(BUS_LCD);
 	command(PCD8544_FUNCTIONSET | PCD8544_EXTENDEDINSTRUCTION );
 	command( PCD8544_SETVOP | val);
 	command(PCD8544_FUNCTIONSET);
+	busRelease();
 	
 }
 
-void P3310::display(void) {
-	uint8_t col, p;
-	uint16_t baddr;
-	baddr = 0;
-	for(p = 0; p < 6; p++) {
+//Sends lcd_buffer[c0..c1] of bank p, returns the number of data bytes
+uint8_t P3310::sendRun(uint8_t p, uint8_t c0, uint8_t c1) {
+	uint16_t baddr = (p * LCDWIDTH) + c0;
+	uint8_t n = c1 - c0 + 1;
+	
+	command(PCD8544_SETYADDR | p);
+	command(PCD8544_SETXADDR | c0);
+	
+	digitalWrite(LCD_DC, HIGH);
+	digitalWrite(LCD_CS, LOW);
+	for(; c0 <= c1; c0++) {
+		SPI.transfer(lcd_buffer[baddr++]);
+	}
+	digitalWrite(LCD_CS, HIGH);
+	return n;
+}
 
-		command(PCD8544_SETYADDR | p);
-		command(PCD8544_SETXADDR);
+#ifdef LCD_SHADOW
+//Sends only the bytes of the dirty span that differ from what the LCD shows,
+//bridging gaps that cost less than a new SETXADDR
+uint8_t P3310::sendDiff(uint8_t p) {
+	uint8_t col, c0, gap;
+	uint8_t n = 0;
+	uint16_t baddr = (p * LCDWIDTH) + dirtyL[p];
+	
+	c0 = 0xFF;
+	gap = 0;
+	for(col = dirtyL[p]; col <= dirtyR[p]; col++, baddr++) {
+		if(lcd_buffer[baddr] != lcd_shadow[baddr]) {
+			lcd_shadow[baddr] = lcd_buffer[baddr];
+			if(c0 == 0xFF) c0 = col;
+			gap = 0;
+		}
+		else if((c0 != 0xFF) && (++gap > LCD_MERGEGAP)) {
+			n += sendRun(p, c0, col - gap);
+			c0 = 0xFF;
+		}
+	}
+	if(c0 != 0xFF)
+		n += sendRun(p, c0, dirtyR[p] - gap);
+	return n;
+}
+#endif
+
+void P3310::display(void) {
+	uint8_t p;
+	uint16_t sent = 0;
+	busTake(BUS_LCD);
+	for(p = 0; p < (LCDHEIGHT / 8); p++) {
+		if(dirtyL[p] > dirtyR[p]) continue; //nothing changed in this bank
 		
-		digitalWrite(LCD_DC, HIGH);
-		digitalWrite(LCD_CS, LOW);
-		for(col = 0; col < LCDWIDTH; col++) {
-			SPI.transfer(lcd_buffer[baddr++]);
+#ifdef LCD_SHADOW
+		if(shadowValid)
+			sent += sendDiff(p);
+		else
+#endif
+		sent += sendRun(p, dirtyL[p], dirtyR[p]);
+		
+		dirtyL[p] = 0xFF;
+		dirtyR[p] = 0;
+	}
+#ifdef LCD_SHADOW
+	if(!shadowValid) { //LCDinit marks everything dirty, so the LCD now shows lcd_buffer
+		memcpy(lcd_shadow, lcd_buffer, LCDWIDTH*LCDHEIGHT/8);
+		shadowValid = 1;
+	}
+#endif
+	frameSent = sent;
+	frameSaved = (LCDWIDTH * LCDHEIGHT / 8) - sent;
+	if(sent)
+		command(PCD8544_SETYADDR );  // no idea why this is necessary but it is to finish the last byte?
+	busRelease();
+}
+
+void P3310::displayAsync(void) {
+	uint8_t p, l, r;
+	uint16_t sent = 0;
+#ifdef LCD_SHADOW
+	uint16_t baddr;
+#endif
+	
+	displayWait();
+	aN = 0;
+	for(p = 0; p < (LCDHEIGHT / 8); p++) {
+		l = dirtyL[p];
+		r = dirtyR[p];
+		dirtyL[p] = 0xFF;
+		dirtyR[p] = 0;
+		if(l > r) continue;
+#ifdef LCD_SHADOW
+		//one run per bank here, trimmed to the bytes that changed;
+		//the interrupt updates the shadow with what it actually sent
+		if(shadowValid) {
+			baddr = p * LCDWIDTH;
+			while((l <= r) && (lcd_buffer[baddr + l] == lcd_shadow[baddr + l])) l++;
+			while((r > l) && (lcd_buffer[baddr + r] == lcd_shadow[baddr + r])) r--;
+			if(l > r) continue;
 		}
-		digitalWrite(LCD_CS, HIGH);
+#endif
+		aY[aN] = p;
+		aL[aN] = l;
+		aR[aN] = r;
+		aN++;
+		sent += r - l + 1;
+	}
+	frameSent = sent;
+	frameSaved = (LCDWIDTH * LCDHEIGHT / 8) - sent;
+	if(aN == 0) {
+		if(displayDone) displayDone();
+		return;
+	}
+	
+	busTake(BUS_LCD);
+	asyncLCD = this;
+	aBusy = 1;
+	aRun = 0;
+	aStep = 0;
+	digitalWrite(LCD_DC, LOW);
+	digitalWrite(LCD_CS, LOW);
+	SPCR |= _BV(SPIE);
+	SPDR = PCD8544_SETYADDR | aY[0];
+}
 
+uint8_t P3310::displayBusy(void) {
+	return aBusy;
+}
+
+void P3310::displayWait(void) {
+	while(aBusy);
+}
+
+//One byte went out, queue the next one.
+//CS stays low for the whole frame, DC switches between commands and data.
+void P3310::SPIisr(void) {
+	uint8_t b;
+	switch(aStep) {
+		case 0: //SETYADDR sent
+			SPDR = PCD8544_SETXADDR | aL[aRun];
+			aStep = 1;
+			break;
+		case 1: //SETXADDR sent, start the data
+			LCD_PORT |= LCD_DC_MASK;
+			aPos = (aY[aRun] * LCDWIDTH) + aL[aRun];
+			aEnd = (aY[aRun] * LCDWIDTH) + aR[aRun];
+			aStep = 2;
+			// fall through
+		case 2:
+			if(aPos <= aEnd) {
+				b = lcd_buffer[aPos];
+#ifdef LCD_SHADOW
+				lcd_shadow[aPos] = b;
+#endif
+				aPos++;
+				SPDR = b;
+				break;
+			}
+			LCD_PORT &= ~LCD_DC_MASK;
+			if(++aRun < aN) {
+				SPDR = PCD8544_SETYADDR | aY[aRun];
+				aStep = 0;
+				break;
+			}
+			SPDR = PCD8544_SETYADDR; //same trailing command as display()
+			aStep = 3;
+			break;
+		default: //frame done
+			LCD_PORT |= LCD_CS_MASK;
+			SPCR &= ~_BV(SPIE);
+			aBusy = 0;
+			busRelease();
+			if(displayDone) displayDone();
 	}
-	command(PCD8544_SETYADDR );  // no idea why this is necessary but it is to finish the last byte?
+}
+
+ISR(SPI_STC_vect)
+{
+	asyncLCD->SPIisr();
 }
 
 void P3310::clearDisplay(void) {
+	uint8_t col, p;
+	uint16_t baddr = 0;
+	displayWait();
+	//Only what is lit now has to be blanked on the LCD
+	for(p = 0; p < (LCDHEIGHT / 8); p++) {
+		for(col = 0; col < LCDWIDTH; col++) {
+			if(lcd_buffer[baddr++] == 0) continue;
+			if(col < dirtyL[p]) dirtyL[p] = col;
+			if(col > dirtyR[p]) dirtyR[p] = col;
+		}
+	}
 	memset(lcd_buffer, 0, LCDWIDTH*LCDHEIGHT/8);
 }
 
-void P3310::putBmp(uint16_t EEplace, uint8_t x, uint8_t y) {
-	uint8_t w, h;
-	uint16_t buffpos;
+void P3310::markDirty(uint16_t pos, uint8_t len) {
+	uint8_t p, c0;
+	uint16_t c1;
+	
+	if(len == 0) return;
+	displayWait();
+	p = pos / LCDWIDTH;
+	c0 = pos % LCDWIDTH;
+	c1 = c0 + len - 1;
+	while(p < (LCDHEIGHT / 8)) {
+		if(c0 < dirtyL[p]) dirtyL[p] = c0;
+		if(c1 >= LCDWIDTH) {
+			//span wraps into the next bank
+			dirtyR[p] = LCDWIDTH - 1;
+			c1 -= LCDWIDTH;
+			c0 = 0;
+			p++;
+			continue;
+		}
+		if(c1 > dirtyR[p]) dirtyR[p] = c1;
+		return;
+	}
+}
+
+void P3310::markAllDirty(void) {
+	displayWait();
+	memset(dirtyL, 0, sizeof(dirtyL));
+	memset(dirtyR, LCDWIDTH - 1, sizeof(dirtyR));
+}
+
+uint8_t &P3310::LCDbyte(uint16_t pos) {
+	markDirty(pos, 1);
+	return lcd_buffer[pos];
+}
+
+///BITMAPS
+//Bitmap bytes, from the staging buffer as far as it covers them
+void P3310::bmpFetch(uint16_t addr, uint8_t *dst, uint8_t n) {
+#if BMP_PREFETCH > 0
+	uint16_t off = addr - stageAddr;
+	
+	if(off < stageLen) {
+		uint8_t k = stageLen - off;
+		if(k > n) k = n;
+		memcpy(dst, bmpStage + off, k);
+		addr += k;
+		dst += k;
+		n -= k;
+	}
+	if(n == 0) return;
+#endif
+	if(!EEstream) {
+		EEreadmem(addr, dst, n);
+		return;
+	}
+	if(!EEstream->isOpen || (addr < EEstream->pos) || (addr > EEstream->pos + 4))
+		EEstream->open(addr);
+	else if(addr > EEstream->pos) EEstream->skip(addr - EEstream->pos); //a small gap
+	EEstream->read(dst, n);
+}
+
+//Ends the bitmap reads of a call, the bus is needed by others
+void P3310::bmpDone(void) {
+	if(EEstream) EEstream->close();
+}
+
+void P3310::bmpPrefetch(uint16_t EEplace) {
+#if BMP_PREFETCH > 0
+	EEplace += idx_zbmp;
+	if(EEplace == stageAddr) return; //already there or on its way
+	stageAddr = EEplace;
+	stageLen = 0;
+	stageWant = BMP_PREFETCH;
+#endif
+}
+
+uint8_t P3310::bmpPrefetchStep(void) {
+#if BMP_PREFETCH > 0
+	uint8_t n;
+	uint16_t size;
+	
+	if(stageLen >= stageWant) return 1;
+	if(SPIowner != BUS_FREE) return 0; //LCD frame or PGA in progress, try later
+	
+	n = stageWant - stageLen;
+	if(n > BMP_CHUNK) n = BMP_CHUNK;
+	bmpFetch(stageAddr + stageLen, bmpStage + stageLen, n);
+	bmpDone();
+	if((stageLen == 0) && !(bmpStage[0] & BMP_PACKED)) {
+		//raw: the size is known, same rows as putBmp draws
+		size = 2 + bmpStage[0] * ((bmpStage[1] / 8) + 1);
+		if(size < stageWant) stageWant = size;
+	}
+	stageLen += n;
+	return stageLen >= stageWant;
+#else
+	return 1;
+#endif
+}
+
+void P3310::bmpOpen(BmpReader *r, uint16_t EEplace) {
+	uint8_t hdr[2];
 	
 	EEplace += idx_zbmp;
+	bmpFetch(EEplace, hdr, 2);
+	r->w = hdr[0];
+	r->h = hdr[1];
+	r->packed = r->w & BMP_PACKED;
+	r->w &= ~BMP_PACKED;
+	r->addr = EEplace + 2;
+	r->bpos = BMP_CHUNK; //empty
+	r->run = 0;
+}
+
+//Next compressed byte, the input is read in BMP_CHUNK bursts
+uint8_t P3310::bmpIn(BmpReader *r) {
+	uint8_t b;
+	
+	if(EEstream) { //no need to buffer
+		bmpFetch(r->addr++, &b, 1);
+		return b;
+	}
+	if(r->bpos >= BMP_CHUNK) {
+		bmpFetch(r->addr, r->buf, BMP_CHUNK);
+		r->addr += BMP_CHUNK;
+		r->bpos = 0;
+	}
+	return r->buf[r->bpos++];
+}
+
+//Next decoded byte of a packed bitmap
+uint8_t P3310::bmpByte(BmpReader *r) {
+	int8_t hdr;
+	
+	while(r->run == 0) {
+		hdr = bmpIn(r);
+		if(hdr == -128) continue; //no-op
+		if(hdr >= 0) {
+			r->run = hdr + 1; //literal bytes follow
+		}
+		else {
+			r->val = bmpIn(r);
+			r->run = hdr - 1; //1-hdr repeats, counted as negative
+		}
+	}
+	if(r->run > 0) {
+		r->run--;
+		return bmpIn(r);
+	}
+	r->run++;
+	return r->val;
+}
+
+void P3310::bmpRead(BmpReader *r, uint8_t *dst, uint8_t n) {
+	if(!r->packed) {
+		bmpFetch(r->addr, dst, n);
+		r->addr += n;
+		return;
+	}
+	while(n--) *dst++ = bmpByte(r);
+}
+
+void P3310::bmpSkip(BmpReader *r, uint8_t n) {
+	if(!r->packed) {
+		r->addr += n;
+		return;
+	}
+	while(n--) bmpByte(r);
+}
+
+void P3310::putBmp(uint16_t EEplace, uint8_t x, uint8_t y) {
+	BmpReader r;
+	uint8_t rows;
+	uint16_t buffpos;
 	
-	w = EEreadbyte(EEplace++);
-	h = EEreadbyte(EEplace++);
+	displayWait();
+	bmpOpen(&r, EEplace);
 	/*Serial.print(EEplace);
 	Serial.print(" ");
 	Serial.print(w);
@@ -185,25 +559,153 @@ void P3310::putBmp(uint16_t EEplace, uint8_t x, uint8_t y) {
 	
 	Serial.println(" ");*/
 	
-	if((w==LCDWIDTH)&&(h==LCDHEIGHT))
+	if((r.w==LCDWIDTH)&&(r.h==LCDHEIGHT))
 	{//full screen bitmap shortcut
-		EEreadmem(EEplace, lcd_buffer, LCDWIDTH*LCDHEIGHT/8);
+		for(rows = 0; rows < (LCDHEIGHT / 8); rows++)
+			bmpRead(&r, lcd_buffer + (rows * LCDWIDTH), LCDWIDTH);
+		bmpDone();
+		markAllDirty();
 		return;
 	}
 	
+	//raw bitmaps have always been drawn with one extra row
+	rows = r.packed ? (r.h + 7) / 8 : (r.h / 8) + 1;
 	buffpos = (x*LCDWIDTH) + y;
 	//x is the row, not the pixel!
-	for(int i = 0; i <= (h /8); i++)
+	for(int i = 0; i < rows; i++)
 	{
-		EEreadmem(EEplace, lcd_buffer+buffpos, w);
-		EEplace+=w;
+		bmpRead(&r, lcd_buffer+buffpos, r.w);
+		markDirty(buffpos, r.w);
 		buffpos += LCDWIDTH;
 	} 
+	bmpDone();
+}
+
+void P3310::aniStart(AniPlayer *a, uint16_t EEplace, uint8_t x, uint8_t y) {
+	uint8_t hdr[4];
+	
+	bmpFetch(EEplace + idx_zbmp, hdr, 4);
+	a->nframes = hdr[0];
+	a->w = hdr[3] & ~BMP_PACKED;
+	if(a->w == 0) a->nframes = 0; //not an animation
+	a->addr = EEplace + idx_zbmp + 3 + hdr[1] + (hdr[2] << 8);
+	a->frame = 0;
+	a->x = x;
+	a->y = y;
+	blit(EEplace + 3, y, x * 8, BLIT_COPY); //exact rows, unlike putBmp
+}
+
+uint8_t P3310::aniStep(AniPlayer *a) {
+	uint8_t d[LCDWIDTH];
+	uint8_t runs, len, n, i;
+	uint16_t off, bank, col, pos;
+	
+	if((a->frame + 1) >= a->nframes) return 0;
+	a->frame++;
+	displayWait();
+	
+	bmpFetch(a->addr++, &runs, 1);
+	while(runs--) {
+		bmpFetch(a->addr, d, 3);
+		off = d[0] + (d[1] << 8);
+		len = d[2];
+		a->addr += 3;
+		
+		//a run stays in one bank row of the bitmap, clip it to the screen like blit
+		bank = a->x + (off / a->w);
+		col = a->y + (off % a->w);
+		n = 0;
+		if((bank < (LCDHEIGHT / 8)) && (col < LCDWIDTH))
+			n = (len > (LCDWIDTH - col)) ? LCDWIDTH - col : len;
+		if(n) {
+			bmpFetch(a->addr, d, n);
+			pos = (bank * LCDWIDTH) + col;
+			for(i = 0; i < n; i++)
+				lcd_buffer[pos + i] ^= d[i];
+			markDirty(pos, n);
+		}
+		a->addr += len;
+	}
+	bmpDone();
+	return 1;
+}
+
+//Combines the bits of src selected by mask into the buffer byte at pos
+static inline void blitByte(uint8_t *d, uint8_t src, uint8_t mask, uint8_t mode)
+{
+	src &= mask;
+	switch(mode)
+	{
+		case BLIT_OR: *d |= src; break;
+		case BLIT_ANDNOT: *d &= ~src; break;
+		case BLIT_XOR: *d ^= src; break;
+		default: *d = (*d & ~mask) | src;
+	}
+}
+
+void P3310::blit(uint16_t EEplace, int16_t x, int16_t y, uint8_t mode)
+{
+	uint8_t line[LCDWIDTH]; //one bank row of the source, visible columns only
+	BmpReader rd;
+	uint8_t w, h, rows, r, i, n, sx, s, mask;
+	int16_t yy, b;
+	uint16_t pos;
+	
+	displayWait();
+	bmpOpen(&rd, EEplace);
+	w = rd.w;
+	h = rd.h;
+	
+	//clip columns
+	if((x >= LCDWIDTH) || ((x + w) <= 0) || (y >= LCDHEIGHT) || ((y + h) <= 0)) {
+		bmpDone();
+		return;
+	}
+	sx = (x < 0) ? -x : 0;
+	x += sx;
+	n = w - sx;
+	if((x + n) > LCDWIDTH) n = LCDWIDTH - x;
+	
+	rows = (h + 7) / 8;
+	for(r = 0; r < rows; r++)
+	{
+		yy = y + (r * 8);
+		if(yy >= LCDHEIGHT) break;
+		if((yy + 8) <= 0) {
+			bmpSkip(&rd, w);
+			continue;
+		}
+		
+		bmpSkip(&rd, sx);
+		bmpRead(&rd, line, n);
+		bmpSkip(&rd, w - sx - n);
+		mask = ((r == rows - 1) && (h & 7)) ? (1 << (h & 7)) - 1 : 0xFF;
+		//source row lands across banks b and b+1, shifted down by s
+		b = ((yy + LCDHEIGHT) / 8) - (LCDHEIGHT / 8);
+		s = (yy + LCDHEIGHT) & 7;
+		
+		if(b >= 0)
+		{
+			pos = (b * LCDWIDTH) + x;
+			markDirty(pos, n);
+			for(i = 0; i < n; i++)
+				blitByte(&lcd_buffer[pos + i], line[i] << s, mask << s, mode);
+		}
+		if((s != 0) && ((b + 1) < (LCDHEIGHT / 8)))
+		{
+			pos = ((b + 1) * LCDWIDTH) + x;
+			markDirty(pos, n);
+			for(i = 0; i < n; i++)
+				blitByte(&lcd_buffer[pos + i], line[i] >> (8 - s), mask >> (8 - s), mode);
+		}
+	}
+	bmpDone();
 }
 
 void P3310::battBar(void)
 {
 	uint16_t pos = (5*LCDWIDTH)-4;
+	markDirty(pos, 4); //waits for an async frame
 	lcd_buffer[pos++] = 0x1F;
 	lcd_buffer[pos++] = 0x11;
 	lcd_buffer[pos++] = 0x11;
@@ -211,6 +713,7 @@ void P3310::battBar(void)
 	uint8_t bat = (byte)((GetBatt()) >> 5);
 	
 	pos = (3*LCDWIDTH);
+	markDirty(pos, 5);
 	lcd_buffer[pos++] = 0x80;
 	lcd_buffer[pos++] = 0x80;
 	lcd_buffer[pos++] = 0x80;
@@ -218,6 +721,7 @@ void P3310::battBar(void)
 	lcd_buffer[pos++] = 0x80;
 	
 	pos = (4*LCDWIDTH);
+	markDirty(pos, 5);
 	lcd_buffer[pos++] = 0x01;
 	lcd_buffer[pos++] = 0x02;
 	lcd_buffer[pos++] = 0x1F;
@@ -227,6 +731,7 @@ void P3310::battBar(void)
 	if(bat >= 108) //1 (3.45v)
 	{
 		pos = (4*LCDWIDTH)-3;
+		markDirty(pos, 3);
 		lcd_buffer[pos++] = 0x80;
 		lcd_buffer[pos++] = 0xBF;
 		lcd_buffer[pos++] = 0x3F;
@@ -234,6 +739,7 @@ void P3310::battBar(void)
 	else
 	{
 		pos = (4*LCDWIDTH)-3;
+		markDirty(pos, 3);
 		lcd_buffer[pos++] = 0x80;
 		lcd_buffer[pos++] = 0x80;
 		lcd_buffer[pos++] = 0;
@@ -243,6 +749,7 @@ void P3310::battBar(void)
 	if(bat >= 111) //2 (3.55v)
 	{
 		pos = (3*LCDWIDTH)-2;
+		markDirty(pos, 2);
 		lcd_buffer[pos++] = 0x7F;
 		lcd_buffer[pos++] = 0x7F;
 	}
@@ -250,6 +757,7 @@ void P3310::battBar(void)
 	if(bat >= 116) //3 (3.7v)
 	{
 		pos = (2*LCDWIDTH)-3;
+		markDirty(pos, 3);
 		lcd_buffer[pos++] = 0x7F;
 		lcd_buffer[pos++] = 0x7F;
 		lcd_buffer[pos++] = 0x7F;
@@ -258,6 +766,7 @@ void P3310::battBar(void)
 	if(bat >= 122) //4 (3.9v)
 	{
 		pos = (1*LCDWIDTH)-4;
+		markDirty(pos, 4);
 		lcd_buffer[pos++] = 0x7F;
 		lcd_buffer[pos++] = 0x7F;
 		lcd_buffer[pos++] = 0x7F;
@@ -265,37 +774,168 @@ void P3310::battBar(void)
 	}
 }
 
-///FONTS
-struct Font{
-	uint16_t EEMainOff;
-	uint8_t *BigOffs; //array with block offsets from the main one
-	const prog_char PROGMEM  *chars;
-	//const uint8_t (*chars)[3][0x20]; //array of arrays of offsets for single characters
-};
-Font fonts[2];
+///ASSETS
+uint8_t P3310::assetLoad(const uint16_t *want, uint8_t n)
+{
+	uint8_t e[4];
+	uint16_t count, crc = 0, id, last = 0;
+	uint8_t k;
+	
+	assetCount = 0;
+	EEreadmem(ASSET_DIR, e, 2);
+	count = e[0] | (e[1] << 8);
+	if(count > (PGACalData - ASSET_DIR - 4) / 4) return 0; //erased or garbage
+	crc = _crc_xmodem_update(crc, e[0]);
+	crc = _crc_xmodem_update(crc, e[1]);
+	
+	for(uint16_t i = 0; i < count; i++)
+	{
+		EEreadmem(ASSET_DIR + 2 + (i * 4L), e, 4);
+		for(k = 0; k < 4; k++) crc = _crc_xmodem_update(crc, e[k]);
+		id = e[0] | (e[1] << 8);
+		if(i && (id <= last)) //not sorted, can't be a directory
+		{
+			assetCount = 0;
+			return 0;
+		}
+		last = id;
+		
+		for(k = 0; k < n; k++)
+			if(pgm_read_word(&want[k]) == id) break;
+		if((k < n) && (assetCount < ASSET_MAX))
+		{
+			assets[assetCount].id = id;
+			assets[assetCount].addr = (e[2] | (e[3] << 8)) - idx_zbmp;
+			assetCount++;
+		}
+	}
+	
+	EEreadmem(ASSET_DIR + 2 + (count * 4L), e, 2);
+	if(crc != (e[0] | (e[1] << 8))) assetCount = 0;
+	return assetCount;
+}
 
+uint16_t P3310::asset(uint16_t id, uint16_t fallback)
+{
+	uint8_t lo = 0, hi = assetCount, mid;
+	
+	while(lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if(assets[mid].id < id) lo = mid + 1;
+		else hi = mid;
+	}
+	if((lo < assetCount) && (assets[lo].id == id)) return assets[lo].addr;
+	return fallback;
+}
+
+///FONTS
 void P3310::InitChars()
 {
-	//Small/bold
-	fonts[0].EEMainOff = idx_font_sb;
-	fonts[0].BigOffs = OffsetsSB;
-	fonts[0].chars = &fntSB[0];
-	//Small/plain
-	fonts[1].EEMainOff = idx_font_sp;
-	fonts[1].BigOffs = OffsetsSP;
-	fonts[1].chars = &fntSP[0];
+	glyphFlush();
+}
+
+void P3310::glyphFlush()
+{
+#if GLYPH_CACHE > 0
+	for(uint8_t i = 0; i < GLYPH_CACHE; i++)
+	{
+		glyphs[i].font = 0xFF;
+		glyphLRU[i] = i;
+	}
+#endif
+	glyphHits = 0;
+	glyphMisses = 0;
+#if BMP_PREFETCH > 0
+	stageAddr = 0; //the staged bitmap may be stale too
+	stageLen = 0;
+	stageWant = 0;
+#endif
+}
+
+//Index entry of cha in font, '?' for chars the font doesn't have
+FontChar P3310::charIdx(uint8_t font, char cha)
+{
+	FontChar fc;
+	uint8_t i = (uint8_t)cha - FONT_FIRST;
+	
+	if(i >= FONT_CHARS) i = '?' - FONT_FIRST;
+	memcpy_P(&fc, &fontIdx[font][i], sizeof(FontChar));
+	if(fc.wid == 0)
+		memcpy_P(&fc, &fontIdx[font]['?' - FONT_FIRST], sizeof(FontChar));
+	return fc;
+}
+
+//Reads the glyph into g with a single burst: width byte, then the columns.
+//The large font is stored as interleaved (bottom, top) pairs and comes out
+//as the top bank row followed by the bottom one.
+void P3310::readGlyph(uint8_t font, FontChar fc, uint8_t *g)
+{
+	uint8_t raw[GLYPH_MAX];
+	uint8_t i, w;
+	
+	w = fc.wid;
+	if(font != FONT_L)
+	{
+		if(w > (GLYPH_MAX - 1)) w = GLYPH_MAX - 1;
+		EEreadmem(fc.off, g, w + 1);
+		g[0] = w;
+		return;
+	}
+	
+	if(w > ((GLYPH_MAX - 1) / 2)) w = (GLYPH_MAX - 1) / 2;
+	EEreadmem(fc.off, raw, (w * 2) + 1);
+	g[0] = w;
+	for(i = 0; i < w; i++)
+	{
+		g[1 + i] = raw[2 + (i * 2)];
+		g[1 + w + i] = raw[1 + (i * 2)];
+	}
+}
+
+//Returns the glyph of cha as laid out by readGlyph.
+//Misses replace the least recently used cache entry.
+const uint8_t *P3310::getGlyph(uint8_t font, char cha)
+{
+#if GLYPH_CACHE > 0
+	uint8_t i, e;
+	for(i = 0; i < GLYPH_CACHE; i++)
+	{
+		e = glyphLRU[i];
+		if((glyphs[e].font == font) && (glyphs[e].cha == cha))
+			break;
+	}
+	if(i < GLYPH_CACHE)
+		glyphHits++;
+	else
+	{
+		glyphMisses++;
+		i = GLYPH_CACHE - 1;
+		e = glyphLRU[i];
+		readGlyph(font, charIdx(font, cha), glyphs[e].data);
+		glyphs[e].font = font;
+		glyphs[e].cha = cha;
+	}
+	for(; i > 0; i--) glyphLRU[i] = glyphLRU[i - 1];
+	glyphLRU[0] = e;
+	return glyphs[e].data;
+#else
+	static uint8_t g[GLYPH_MAX];
+	readGlyph(font, charIdx(font, cha), g);
+	return g;
+#endif
 }
 
 void P3310::LCDputsL(char* str, uint8_t line, uint8_t col)
 {
-	uint8_t i, wid;
-	uint8_t cha;
-	uint16_t eeaddr, buffadd;
+	uint8_t wid;
+	uint16_t buffadd;
+	const uint8_t *g;
 	
+	displayWait();
 	buffadd = (line * 84) + col;
 	while(str[0] != 0)
 	{
-//Serial.print(str[0]);
 		if(str[0] == ' ')
 		{
 			buffadd += 3;
@@ -306,28 +946,21 @@ void P3310::LCDputsL(char* str, uint8_t line, uint8_t col)
 		{
 			lcd_buffer[buffadd+84] = 0x0C;
 			lcd_buffer[buffadd+85] = 0x0C;
+			markDirty(buffadd+84, 2);
 			buffadd += 3;
 			str++;
 			continue;
 		}
 		
-		if((str[0] < 0x30) || (str[0] > 0x7A)) str[0] = '?';
-
-/*Serial.print(" c:");
-Serial.print(str[0] - 0x30);
-Serial.print(" readw:");
-Serial.print(pgm_read_word_near(str[0] - 0x30));*/
-		eeaddr = idx_font_l + pgm_read_word_near(fnt1 + (str[0] - 0x30));//fnt1[str[0] - 0x30];
-		wid = EEreadbyte(eeaddr++);
-//Serial.print(" wid:");
-//Serial.print(wid);
+		g = getGlyph(FONT_L, str[0]);
+		wid = *g++;
 		//Should I add something to jump to the next line instead of cutting the character?
 		//Nah; I wouldn't want it to wrap at the end of the screen anyway.
-		for(i = 0; i < wid; i++)
-		{
-			lcd_buffer[buffadd+84] = EEreadbyte(eeaddr++);
-			lcd_buffer[buffadd++] = EEreadbyte(eeaddr++);
-		}
+		markDirty(buffadd, wid);
+		markDirty(buffadd+84, wid);
+		memcpy(lcd_buffer+buffadd, g, wid);
+		memcpy(lcd_buffer+buffadd+84, g+wid, wid);
+		buffadd += wid;
 		buffadd++; //white space after char
 		str++;
 	}
@@ -336,59 +969,208 @@ Serial.print(pgm_read_word_near(str[0] - 0x30));*/
 
 void P3310::LCDputs(char* str, uint8_t line, uint8_t col, uint8_t nfont)
 {
-	uint8_t i, p, wid;
-	uint8_t cha;
-	uint16_t eeaddr, buffadd;
+	uint8_t wid;
+	uint16_t buffadd;
+	const uint8_t *g;
 	
+	displayWait();
 	buffadd = (line * 84) + col;
 	while(str[0] != 0)
 	{
-		p = 0;
-		cha = str[0] - 0x20;
-		//Serial.print(str[0]);
-		//Serial.print(" cha:");
-		//Serial.print(cha, HEX);
-		
-		if(cha >= 0x60) cha = 0x59; //0x59 = unknown char
-		
-		
-		eeaddr = fonts[nfont].EEMainOff;
-		while(cha >= 0x20)
-		{
-			eeaddr += fonts[nfont].BigOffs[p];
-			cha -= 0x20;
-			p++;
-		}
-		eeaddr += pgm_read_byte_near(fonts[nfont].chars + cha + (p * 0x20));
-		//eeaddr += fonts[nfont].chars[0][p][cha];
-		//Serial.print(" idx:");
-		//Serial.print(cha,HEX);
-		//Serial.print(" eea:");
-		//Serial.print(eeaddr);
-		
-		wid = EEreadbyte(eeaddr++);
-//		Serial.print(" wid:");
-//		Serial.print(wid);
+		g = getGlyph(nfont, str[0]);
+		wid = *g++;
+		markDirty(buffadd, wid);
 
 		//Should I add something to jump to the next line instead of cutting the character?
 		//Nah; I wouldn't want it to wrap at the end of the screen anyway.
-		for(i = 0; i < wid; i++)
-		{
-			lcd_buffer[buffadd++] = EEreadbyte(eeaddr++);
-//			Serial.print(" ");
-//			Serial.print(lcd_buffer[buffadd-1],HEX);
-		}
-//		Serial.println(" ");
+		memcpy(lcd_buffer+buffadd, g, wid);
+		buffadd += wid;
 		buffadd++; //white space after char
 		str++;
 	}
 	//display();
 }
 
+//Pixel width of str as LCDputs/LCDputsL would draw it, without the trailing space
+uint8_t P3310::textWidth(const char* str, uint8_t nfont)
+{
+	uint16_t w = 0;
+	
+	while(str[0] != 0)
+	{
+		if((nfont == FONT_L) && ((str[0] == ' ') || (str[0] == '.')))
+			w += 3;
+		else
+			w += charIdx(nfont, str[0]).wid + 1;
+		str++;
+	}
+	if(w > 0) w--;
+	if(w > 0xFF) w = 0xFF;
+	return w;
+}
+
+void P3310::LCDputsC(char* str, uint8_t line, uint8_t nfont)
+{
+	uint8_t w = textWidth(str, nfont);
+	uint8_t col = (w < LCDWIDTH) ? (LCDWIDTH - w) / 2 : 0;
+	
+	if(nfont == FONT_L) LCDputsL(str, line, col);
+	else LCDputs(str, line, col, nfont);
+}
+
+void P3310::LCDputsR(char* str, uint8_t line, uint8_t right, uint8_t nfont)
+{
+	uint8_t w = textWidth(str, nfont);
+	uint8_t col = (w < right) ? right - w : 0;
+	
+	if(nfont == FONT_L) LCDputsL(str, line, col);
+	else LCDputs(str, line, col, nfont);
+}
+
+///EEPROM STREAM
+void EEStream::open(long addr)
+{
+	close();
+	busTake(BUS_EE);
+	digitalWrite(EE_CS, LOW);
+	SPI.transfer(EE_READ);
+	SPI.transfer(addr >> 16);
+	SPI.transfer(addr >> 8);
+	SPI.transfer(addr);
+	pos = addr;
+	isOpen = 1;
+}
+
+uint8_t EEStream::read(void)
+{
+	pos++;
+	return SPI.transfer(0xFF);
+}
+
+void EEStream::read(uint8_t *dst, uint16_t n)
+{
+	pos += n;
+	while(n--) *dst++ = SPI.transfer(0xFF);
+}
+
+void EEStream::skip(uint16_t n)
+{
+	pos += n;
+	while(n--) SPI.transfer(0xFF);
+}
+
+void EEStream::close(void)
+{
+	if(!isOpen) return;
+	digitalWrite(EE_CS, HIGH);
+	busRelease();
+	isOpen = 0;
+}
+
+///FRAME PACING
+uint8_t P3310::frameDue(FrameClock *f, uint16_t period)
+{
+	unsigned long now = millis();
+	
+	if(period != f->period)
+	{
+		f->period = period;
+		f->due = now;
+		f->start = now;
+	}
+	if((long)(now - f->due) < 0) return 0;
+	
+	f->frameTime = now - f->start;
+	f->start = now;
+	if((now - f->due) >= period) f->due = now + period; //a whole frame late, skip it
+	else f->due += period;
+	return 1;
+}
+
+void P3310::frameEnd(FrameClock *f)
+{
+	unsigned long now = millis();
+	uint16_t load;
+	
+	f->work = now - f->start;
+	load = f->period ? ((uint32_t)f->work * 100) / f->period : 0;
+	f->load = (load > 255) ? 255 : load;
+	if((long)(now - f->due) > 0) f->missed++;
+}
+
+//Bit n, bits from n to 7 and from 0 to n of a bank byte
+const uint8_t PROGMEM maskBit[8] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+const uint8_t PROGMEM maskFrom[8] = {0xFF, 0xFE, 0xFC, 0xF8, 0xF0, 0xE0, 0xC0, 0x80};
+const uint8_t PROGMEM maskTo[8] = {0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF};
+
 void P3310::SetPx(uint8_t xp, uint8_t yp)
 {
-	uint8_t tmp = lcd_buffer[(LCDWIDTH * (yp/8)) + xp];
-	lcd_buffer[(LCDWIDTH * (yp/8)) + xp] |= (1 << (yp % 8));
+	if((xp >= LCDWIDTH) || (yp >= LCDHEIGHT)) return;
+	LCDbyte((LCDWIDTH * (yp >> 3)) + xp) |= pgm_read_byte(maskBit + (yp & 7));
+}
+
+void P3310::fillRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t mode)
+{
+	uint8_t b, b1, m, i;
+	uint16_t pos;
+	
+	if((x >= LCDWIDTH) || (y >= LCDHEIGHT) || (w == 0) || (h == 0)) return;
+	if(w > (LCDWIDTH - x)) w = LCDWIDTH - x;
+	if(h > (LCDHEIGHT - y)) h = LCDHEIGHT - y;
+	
+	b1 = (y + h - 1) >> 3;
+	for(b = y >> 3; b <= b1; b++)
+	{
+		m = 0xFF;
+		if(b == (y >> 3)) m &= pgm_read_byte(maskFrom + (y & 7));
+		if(b == b1) m &= pgm_read_byte(maskTo + ((y + h - 1) & 7));
+		
+		pos = (b * LCDWIDTH) + x;
+		markDirty(pos, w); //waits for an async frame
+		switch(mode)
+		{
+			case BLIT_ANDNOT:
+				m = ~m;
+				for(i = 0; i < w; i++) lcd_buffer[pos++] &= m;
+				break;
+			case BLIT_XOR:
+				for(i = 0; i < w; i++) lcd_buffer[pos++] ^= m;
+				break;
+			default:
+				if(m == 0xFF) memset(lcd_buffer + pos, 0xFF, w);
+				else for(i = 0; i < w; i++) lcd_buffer[pos++] |= m;
+		}
+	}
+}
+
+void P3310::hLine(uint8_t x, uint8_t y, uint8_t w, uint8_t mode)
+{
+	fillRect(x, y, w, 1, mode);
+}
+
+void P3310::vLine(uint8_t x, uint8_t y, uint8_t h, uint8_t mode)
+{
+	fillRect(x, y, 1, h, mode);
+}
+
+void P3310::drawRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t mode)
+{
+	if((w == 0) || (h == 0)) return;
+	hLine(x, y, w, mode);
+	if(h > 1) hLine(x, y + h - 1, w, mode);
+	if(h > 2)
+	{
+		vLine(x, y + 1, h - 2, mode);
+		if(w > 1) vLine(x + w - 1, y + 1, h - 2, mode);
+	}
+}
+
+void P3310::fillBytes(uint8_t bank, uint8_t x, uint8_t w, uint8_t val)
+{
+	if((bank >= (LCDHEIGHT / 8)) || (x >= LCDWIDTH)) return;
+	if(w > (LCDWIDTH - x)) w = LCDWIDTH - x;
+	markDirty((bank * LCDWIDTH) + x, w);
+	memset(lcd_buffer + (bank * LCDWIDTH) + x, val, w);
 }
 /*
 
@@ -25,6 +25,7 @@
 #include <spieeprom.h>
 #include <bmp.h>
 #include <PCD.h>
+#include <fontidx.h>
 
 #define OP_CS 9
 #define LCD_DC A2
@@ -39,6 +40,11 @@
 #define PWMaux 3
 #define Vbat A5
 
+//LCD_DC and LCD_CS on their port, written directly by the SPI interrupt
+#define LCD_PORT PORTC
+#define LCD_DC_MASK _BV(2) //A2
+#define LCD_CS_MASK _BV(4) //A4
+
 #define BCmin 450 //Clear
 #define BCmax 550
 #define BMmin 250 //Menu
@@ -56,30 +62,123 @@
 
 #define DefBRT 255
 
-#define EEsize 0xFFFF
-#define idx_font_l 0
-#define idx_font_sb 957
-#define idx_font_sp 1443
-#define idx_zbmp 1855
-#define PGACalData EEsize - 8
+//Keep a copy of what the LCD shows and only send bytes that changed.
+//Costs LCDWIDTH*LCDHEIGHT/8 bytes of RAM, a quarter of a 328's: only for
+//boards that have them. The dirty spans alone already skip what wasn't drawn.
+//#define LCD_SHADOW
+//Equal bytes worth resending instead of starting a new run (SETYADDR+SETXADDR)
+#define LCD_MERGEGAP 3
+
+//Recently drawn glyphs kept in RAM, GLYPH_MAX+2 bytes each. 0 disables the cache.
+//The multimeter page draws about 14 different glyphs a frame: LRU hits 39% of
+//them with 8 entries, nearly all with 16. A miss is one EEPROM burst of up to
+//GLYPH_MAX bytes, so it isn't worth the RAM on a 328.
+#ifndef GLYPH_CACHE
+#define GLYPH_CACHE 0
+#endif
+#define GLYPH_MAX 21 //width byte + widest large char (10 columns, 2 banks)
+#define FONT_L 2 //large font id for the cache, 0 and 1 are the small ones
+
+//Bitmaps are w, h, then (h+7)/8 bank rows of w bytes. With BMP_PACKED set
+//in w the rows are PackBits compressed (see tools/bmpenc).
+#define BMP_PACKED 0x80
+#define BMP_CHUNK 16 //compressed bytes fetched per EEPROM read
+//RAM staging buffer for the next bitmap, see bmpPrefetch(). 0 disables it and
+//bmpPrefetch() does nothing. 130 holds a menu icon, for boards with the RAM.
+#ifndef BMP_PREFETCH
+#define BMP_PREFETCH 0
+#endif
+
+//Asset directory written by tools/assetc at ASSET_DIR: count (lo, hi), then
+//count entries of id and EEPROM address (lo, hi each) sorted by id, then the
+//CRC16 (xmodem, lo first) of all of it. ids are the ASSET_ defines of bmp.h.
+#define ASSET_DIR 0xF800
+#define ASSET_MAX 16 //entries kept in RAM, 4 bytes each
+
+//blit modes
+#define BLIT_COPY 0
+#define BLIT_OR 1
+#define BLIT_ANDNOT 2
+#define BLIT_XOR 3
+
+#define EEsize 0xFFFF //font and bitmap addresses are in bmp.h
+#define PGACalData (EEsize + 1 - 128) //last 128 bytes, PGA calibration
 
 
 #ifndef P3310_H_
 #define P3310_H_
 
-//Large font
-const uint16_t PROGMEM fnt1[74] = {0, 15, 30, 45, 60, 75, 90, 105, 120, 135, 150, 157, 164, 175, 186, 197, 210, 229, 244, 259, 272, 287, 302, 317, 332, 347, 352, 363, 380, 393, 412, 427, 444, 459, 476, 493, 506, 519, 534, 551, 572, 587, 604, 0, 619, 0, 0, 628, 0, 645, 658, 671, 682, 695, 708, 717, 730, 743, 748, 755, 768, 773, 790, 803, 816, 829, 842, 853, 864, 873, 886, 899, 918, 931, };
-		
-//Small/bold font
-const prog_char PROGMEM  fntSB[0x60] = {0, 3, 6, 10, 16, 22, 29, 36, 38, 42, 46, 52, 58, 61, 66, 69, 73, 79, 85, 91, 97, 103, 109, 115, 121, 127, 133, 136, 139, 144, 149, 154,
-0, 7, 13, 19, 25, 31, 37, 43, 49, 55, 58, 63, 70, 75, 83, 90, 97, 103, 110, 116, 121, 128, 134, 141, 149, 156, 163, 0, 169, 0, 0, 173,
-0, 0, 6, 12, 17, 23, 29, 33, 39, 45, 48, 52, 58, 61, 70, 76, 82, 88, 94, 99, 104, 108, 114, 120, 128, 134, 140, 0, 0, 0, 0, 0};
+//SPI bus owners. LCD, EEPROM and PGA share the bus and an async LCD frame
+//keeps it busy in background, so take it before selecting a chip.
+#define BUS_FREE 0
+#define BUS_LCD 1
+#define BUS_EE 2
+#define BUS_PGA 3
+extern volatile uint8_t SPIowner;
+void busTake(uint8_t who);
+void busRelease(void);
 
-//Small/plain font
-const prog_char PROGMEM fntSP[0x60] = {0, 3, 5, 9, 15, 20, 25, 31, 33, 36, 39, 45, 51, 54, 59, 61, 65, 70, 75, 80, 85, 90, 95, 100, 105, 110, 115, 118, 121, 126, 131, 136, 
-0, 6, 11, 16, 21, 26, 31, 36, 41, 46, 48, 52, 57, 62, 68, 74, 80, 85, 91, 96, 101, 107, 112, 118, 126, 132, 138, 0, 143, 0, 0, 147, 
-0, 0, 5, 10, 14, 19, 24, 27, 32, 37, 39, 42, 47, 49, 55, 60, 65, 70, 75, 79, 83, 86, 91, 97, 103, 108, 113, 0, 0, 0, 0, 0};
-		
+struct GlyphEntry{
+	uint8_t font;
+	uint8_t cha;
+	uint8_t data[GLYPH_MAX]; //width, then the columns (top bank first for the large font)
+};
+
+//Streams the rows of a bitmap, packed or not
+struct BmpReader{
+	uint16_t addr; //next EEPROM byte to fetch
+	uint8_t w, h;
+	uint8_t packed;
+	uint8_t buf[BMP_CHUNK];
+	uint8_t bpos;
+	int16_t run; //>0 literal bytes left, <0 repeats left (a literal can be 128)
+	uint8_t val;
+};
+
+//Animations: frame count, keyframe length (lo, hi), the keyframe bitmap,
+//then one delta per following frame: run count, and runs of offset in
+//the bitmap rows (lo, hi), length and that many bytes to XOR in.
+//Runs never cross a bank row. Built with bmpenc -a.
+struct AniPlayer{
+	uint16_t addr; //next delta in EEPROM
+	uint8_t frame, nframes;
+	uint8_t w;
+	uint8_t x, y; //bank row and column, like putBmp
+};
+
+//Sequential reader for the SPI EEPROM (24 bit addresses, like SPIEEPROM
+//type 1). open() holds the bus and keeps CS low until close(), so every
+//read after the first pays no opcode or address. Nothing else can use the
+//bus while a stream is open.
+#define EE_READ 0x03
+
+class EEStream
+{
+	public:
+		void open(long addr);
+		uint8_t read(void);
+		void read(uint8_t *dst, uint16_t n);
+		void skip(uint16_t n); //clocks bytes out, cheaper than reopening for a few
+		void close(void);
+		long pos; //address of the next byte
+		uint8_t isOpen;
+};
+
+struct AssetEntry{
+	uint16_t id;
+	uint16_t addr; //from idx_zbmp, like putBmp wants it
+};
+
+//Frame pacing for a screen drawn every period ms, see frameDue()
+struct FrameClock{
+	unsigned long due; //millis() when the next frame is due
+	unsigned long start; //millis() when the current frame started
+	uint16_t period;
+	uint16_t frameTime; //ms between the last two frames
+	uint16_t work; //ms from frameDue() to frameEnd() in the last frame
+	uint8_t load; //work in % of period, over 100 means too slow
+	uint16_t missed; //frames that ended after the next one was due
+};
 
 class P3310
 {
@@ -89,14 +188,57 @@ class P3310
 uint16_t idx_font_sb = 957;
 uint16_t idx_font_sp = 1443;
 uint16_t idx_zbmp = 1855;*/
-		uint8_t OffsetsSB[2] = {160, 180};
-		uint8_t OffsetsSP[2] = {141, 153}; //Group Offsets
-
+		
+		//Dirty column span for each bank, L > R means the bank is clean
+		uint8_t dirtyL[LCDHEIGHT / 8];
+		uint8_t dirtyR[LCDHEIGHT / 8];
+		
+#ifdef LCD_SHADOW
+		uint8_t lcd_shadow[LCDWIDTH * LCDHEIGHT / 8]; //last frame sent to the LCD
+		uint8_t shadowValid;
+#endif
+		
+#if GLYPH_CACHE > 0
+		GlyphEntry glyphs[GLYPH_CACHE];
+		uint8_t glyphLRU[GLYPH_CACHE]; //entry indexes, most recent first
+#endif
 		
 		void InitChars();
 		
+#if BMP_PREFETCH > 0
+		uint8_t bmpStage[BMP_PREFETCH];
+		uint16_t stageAddr; //EEPROM address of bmpStage[0]
+		uint8_t stageLen, stageWant; //bytes loaded and to load
+#endif
+		
+		AssetEntry assets[ASSET_MAX]; //sorted by id
+		uint8_t assetCount;
+		
+		void bmpFetch(uint16_t addr, uint8_t *dst, uint8_t n);
+		void bmpDone(void);
+		void bmpOpen(BmpReader *r, uint16_t EEplace);
+		uint8_t bmpIn(BmpReader *r);
+		uint8_t bmpByte(BmpReader *r);
+		void bmpRead(BmpReader *r, uint8_t *dst, uint8_t n);
+		void bmpSkip(BmpReader *r, uint8_t n);
+		FontChar charIdx(uint8_t font, char cha);
+		void readGlyph(uint8_t font, FontChar fc, uint8_t *g);
+		const uint8_t *getGlyph(uint8_t font, char cha);
+		
 		void command(uint8_t c);
 		void data(uint8_t c);
+		uint8_t sendRun(uint8_t p, uint8_t c0, uint8_t c1);
+#ifdef LCD_SHADOW
+		uint8_t sendDiff(uint8_t p);
+#endif
+		
+		//Async frame: runs queued by displayAsync() and fed by the SPI interrupt
+		uint8_t aY[LCDHEIGHT / 8];
+		uint8_t aL[LCDHEIGHT / 8];
+		uint8_t aR[LCDHEIGHT / 8];
+		uint8_t aN, aRun, aStep;
+		uint16_t aPos, aEnd;
+		volatile uint8_t aBusy;
 
 		//uint8_t GetPROGMEMbyte(const prog_char * pgm, uint8_t pos);
 		
@@ -113,19 +255,89 @@ uint16_t idx_zbmp = 1855;*/
 		void setContrast(uint8_t val);
 		void display(void);
 		void clearDisplay(void);
+		
+		//Non-blocking display(): returns at once and the frame goes out
+		//from the SPI interrupt, straight from lcd_buffer. The drawing calls
+		//wait for it with displayWait() first; do the same before touching
+		//lcd_buffer yourself.
+		void displayAsync(void);
+		uint8_t displayBusy(void);
+		void displayWait(void);
+		void (*displayDone)(void); //called from the interrupt when the frame is out
+		void SPIisr(void); //SPI interrupt handler, not for you
 
 		uint8_t lcd_buffer[LCDWIDTH * LCDHEIGHT / 8];
+		
+		//Only dirty spans are sent by display(); write through LCDbyte
+		//or call markDirty after touching lcd_buffer directly
+		void markDirty(uint16_t pos, uint8_t len);
+		void markAllDirty(void);
+		uint8_t &LCDbyte(uint16_t pos);
+		
+		//Data bytes sent and saved (against a full 504 byte push) by the last display()
+		uint16_t frameSent;
+		uint16_t frameSaved;
 	
 		byte (*EEreadbyte)(long);
 		void (*EEreadmem)(long, byte *, long);
+		//When set, bitmaps and animations are streamed from here instead of
+		//EEreadmem. Fonts still use the hooks.
+		EEStream *EEstream;
 	
 		void LCDputs(char* str, uint8_t line, uint8_t col, uint8_t nfont);
+		void glyphFlush(void); //call after rewriting fonts or bitmaps in EEPROM
+		uint16_t glyphHits;
+		uint16_t glyphMisses;
 		void LCDputsL(char* str, uint8_t line, uint8_t col);
 		
+		//Layout helpers, nfont is 0, 1 or FONT_L. Widths come from the font
+		//index, so measuring never touches the EEPROM.
+		uint8_t textWidth(const char* str, uint8_t nfont);
+		void LCDputsC(char* str, uint8_t line, uint8_t nfont); //centered
+		void LCDputsR(char* str, uint8_t line, uint8_t right, uint8_t nfont); //ends before column right
+		
 		void putBmp(uint16_t EEplace, uint8_t x, uint8_t y);
 		
+		//Asset directory: assetLoad() reads it from the EEPROM at boot (and
+		//after new assets are flashed), keeping the entries whose id is in
+		//want, a PROGMEM array of n ids. It returns how many it found, 0 if
+		//the directory is missing or corrupt. asset() binary searches them
+		//and returns the place to give putBmp/blit/aniStart, or fallback
+		//for ids it doesn't have.
+		uint8_t assetLoad(const uint16_t *want, uint8_t n);
+		uint16_t asset(uint16_t id, uint16_t fallback);
+		
+		//Loads the bitmap you'll draw next into RAM ahead of time: name it with
+		//bmpPrefetch(), then call bmpPrefetchStep() when idle. Each step reads
+		//BMP_CHUNK bytes, only if nobody holds the SPI bus. putBmp/blit copy
+		//whatever is already loaded and read the rest from the EEPROM.
+		void bmpPrefetch(uint16_t EEplace);
+		uint8_t bmpPrefetchStep(void); //1 when done
+		
+		//Draws the keyframe, then each aniStep() applies the next delta and
+		//marks only the changed bytes dirty. aniStep returns 0 past the last frame.
+		void aniStart(AniPlayer *a, uint16_t EEplace, uint8_t x, uint8_t y);
+		uint8_t aniStep(AniPlayer *a);
+		//Draws a bitmap at any pixel, clipped to the screen. x and y are pixels here.
+		void blit(uint16_t EEplace, int16_t x, int16_t y, uint8_t mode = BLIT_COPY);
+		
+		//Frame pacing: draw when frameDue() returns 1 and call frameEnd()
+		//once the frame is out, the time in between is free for sampling.
+		//A new period restarts the clock. Late frames don't pile up, the
+		//schedule slips instead.
+		uint8_t frameDue(FrameClock *f, uint16_t period);
+		void frameEnd(FrameClock *f);
+		
 		void SetPx(uint8_t xp, uint8_t yp);
 		
+		//Primitives working on whole bank bytes, clipped to the screen.
+		//mode is BLIT_OR/BLIT_COPY to set, BLIT_ANDNOT to clear, BLIT_XOR to invert.
+		void hLine(uint8_t x, uint8_t y, uint8_t w, uint8_t mode = BLIT_OR);
+		void vLine(uint8_t x, uint8_t y, uint8_t h, uint8_t mode = BLIT_OR);
+		void fillRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t mode = BLIT_OR);
+		void drawRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t mode = BLIT_OR);
+		void fillBytes(uint8_t bank, uint8_t x, uint8_t w, uint8_t val); //w columns of bank set to val
+		
 		void battBar(void);
 	//SPIEEPROM(); // default to type 0
 	//SPIEEPROM(byte type); // type=0: 16-bits address
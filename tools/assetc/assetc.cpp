@@ -0,0 +1,754 @@
+/*
+  assetc - builds the EEPROM asset image and the headers that locate it
+
+  Build and run on the host:
+    g++ -O2 -o assetc assetc.cpp
+    ./assetc [-a align] assets.txt eeprom.bin ../../p3310
+    ./assetc -x eeprom.bin bmp.h fontidx.h outdir
+
+  The manifest lists the assets in the order they are laid out, one per
+  line, # starts a comment:
+    font sb|sp|l file.fnt        the three fonts, stored first
+    bmp name file.pbm [packed] [h=N]
+    ani name frame0.pbm frame1.pbm ...
+    group name ... end           bmp lines kept back to back, raw and all
+                                 the same size, so frame n is at
+                                 name + n * name_STRIDE
+  Paths are relative to the manifest. packed bitmaps are PackBits
+  compressed when that makes them smaller, ani builds an animation for
+  P3310::aniStart (see tools/common/bitmap.h). h=N stores a different height in
+  the header than the image has, old raw bitmaps need it because putBmp
+  draws them with an extra row. With -a every font, bitmap, animation
+  and group starts on a multiple of align bytes, keeping unchanged
+  assets on the same EEPROM pages for eeflash.
+
+  The outputs are the image, bmp.h (layout, bitmap offsets from
+  idx_zbmp and directory ids) and fontidx.h (character index); the sizes
+  of everything are reported. The image ends with the asset directory
+  at ASSET_DIR, where the firmware looks bitmaps up by id (the CRC16 of
+  their name), so bitmaps can move without rebuilding the firmware.
+  -x goes the other way: it splits an image into a manifest, .pbm
+  bitmaps and .fnt fonts using the headers it was built with, so the
+  assets of an existing image can be edited.
+
+  .fnt files hold "height 8" (small) or "height 16" (large), then for
+  every char "char 0xNN" followed by height rows of # and . columns.
+  ; starts a comment.
+
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <set>
+
+#include "../common/bitmap.h"
+
+//Same as p3310.h
+#define EEsize 0xFFFF
+#define PGACalData (EEsize + 1 - 128)
+#define ASSET_DIR 0xF800
+#define FONT_FIRST 0x20
+#define FONT_CHARS 0x60
+#define LEGACY_ZBMP 1855 //idx_zbmp of images older than assetc
+
+typedef std::vector<std::string> Words;
+
+const char *fontName[3] = {"sb", "sp", "l"}; //fontIdx order
+
+struct Glyph {
+	uint16_t off;
+	uint8_t wid;
+};
+
+Glyph idx[3][FONT_CHARS];
+
+///Bitmaps, the format is in tools/common/bitmap.h
+
+static bool loadBitmap(const char *name, uint8_t *w, uint8_t *h, Bytes &rows)
+{
+	bool ok;
+	FILE *f = fopen(name, "rb");
+	if(!f) { fprintf(stderr, "can't open %s\n", name); return false; }
+	ok = loadPBM(f, w, h, rows);
+	if(!ok) fprintf(stderr, "%s: not a PBM or too big for a bitmap\n", name);
+	fclose(f);
+	return ok;
+}
+
+static bool saveBitmap(const std::string &name, uint8_t w, uint8_t h, const Bytes &rows)
+{
+	FILE *f = fopen(name.c_str(), "wb");
+	if(!f) { fprintf(stderr, "can't create %s\n", name.c_str()); return false; }
+	savePBM(f, w, h, rows);
+	fclose(f);
+	return true;
+}
+
+///Fonts
+
+static std::string trim(const std::string &s)
+{
+	size_t a = s.find_first_not_of(" \t\r\n"), b = s.find_last_not_of(" \t\r\n");
+	return (a == std::string::npos) ? "" : s.substr(a, b - a + 1);
+}
+
+//Glyphs in EEPROM format, by char code: width, then the columns. The
+//large font has (bottom, top) byte pairs.
+static bool loadFont(const std::string &name, int *height, std::map<int, Bytes> &glyphs)
+{
+	char line[512];
+	int cha = -1, row = 0, lineNo = 0;
+	Bytes cols;
+	FILE *f = fopen(name.c_str(), "r");
+	if(!f) { fprintf(stderr, "can't open %s\n", name.c_str()); return false; }
+	*height = 0;
+	while(fgets(line, sizeof(line), f)) {
+		lineNo++;
+		std::string s = line;
+		if(s.find(';') != std::string::npos) s.erase(s.find(';'));
+		s = trim(s);
+		if(s.empty()) continue;
+		if(!s.compare(0, 7, "height ")) {
+			*height = atoi(s.c_str() + 7);
+			continue;
+		}
+		if(!s.compare(0, 5, "char ")) {
+			cha = strtol(s.c_str() + 5, 0, 0);
+			row = 0;
+			cols.clear();
+			if((*height != 8) && (*height != 16)) break;
+			if((cha < FONT_FIRST) || (cha >= FONT_FIRST + FONT_CHARS)) {
+				fprintf(stderr, "%s:%d: char 0x%02X out of range\n", name.c_str(), lineNo, cha);
+				fclose(f);
+				return false;
+			}
+			continue;
+		}
+		if((cha < 0) || (row >= *height) || (s.find_first_not_of("#.") != std::string::npos)) {
+			fprintf(stderr, "%s:%d: unexpected \"%s\"\n", name.c_str(), lineNo, s.c_str());
+			fclose(f);
+			return false;
+		}
+		if(row == 0) cols.assign(s.size() * (*height / 8), 0);
+		else if(s.size() * (*height / 8) != cols.size()) {
+			fprintf(stderr, "%s:%d: rows of char 0x%02X differ in width\n", name.c_str(), lineNo, cha);
+			fclose(f);
+			return false;
+		}
+		for(size_t x = 0; x < s.size(); x++)
+			if(s[x] == '#') {
+				if(*height == 8) cols[x] |= 1 << row;
+				else cols[(x * 2) + ((row < 8) ? 1 : 0)] |= 1 << (row % 8);
+			}
+		if(++row == *height) {
+			Bytes g(1, s.size());
+			g.insert(g.end(), cols.begin(), cols.end());
+			glyphs[cha] = g;
+		}
+	}
+	fclose(f);
+	if((*height != 8) && (*height != 16)) {
+		fprintf(stderr, "%s: height must be 8 or 16\n", name.c_str());
+		return false;
+	}
+	return true;
+}
+
+static bool saveFont(const std::string &name, int height, const uint8_t *img, long len, const Glyph *index)
+{
+	FILE *f = fopen(name.c_str(), "w");
+	if(!f) { fprintf(stderr, "can't create %s\n", name.c_str()); return false; }
+	fprintf(f, "height %d\n", height);
+	for(int i = 0; i < FONT_CHARS; i++) {
+		const Glyph &g = index[i];
+		if(!g.wid) continue;
+		if((g.off + 1 + (g.wid * height / 8)) > len) {
+			fprintf(stderr, "char 0x%02X past the end of the image\n", i + FONT_FIRST);
+			fclose(f);
+			return false;
+		}
+		const uint8_t *c = img + g.off + 1;
+		fprintf(f, "\nchar 0x%02X ; %c\n", i + FONT_FIRST, i + FONT_FIRST);
+		for(int y = 0; y < height; y++) {
+			for(int x = 0; x < g.wid; x++) {
+				uint8_t b = (height == 8) ? c[x] : c[(x * 2) + ((y < 8) ? 1 : 0)];
+				fputc(((b >> (y % 8)) & 1) ? '#' : '.', f);
+			}
+			fputc('\n', f);
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+///Building
+
+static Words split(const std::string &s)
+{
+	Words w;
+	size_t i = 0;
+	while(i < s.size()) {
+		while((i < s.size()) && isspace((unsigned char)s[i])) i++;
+		size_t b = i;
+		while((i < s.size()) && !isspace((unsigned char)s[i])) i++;
+		if(i > b) w.push_back(s.substr(b, i - b));
+	}
+	return w;
+}
+
+static bool endsWith(const std::string &s, const char *t)
+{
+	size_t n = strlen(t);
+	return (s.size() > n) && !s.compare(s.size() - n, n, t);
+}
+
+//Defines that are places in EEPROM, not counts
+static bool isPlace(const std::string &n)
+{
+	return n.compare(0, 4, "idx_") && n.compare(0, 6, "ASSET_") && (n != "EEimage") &&
+		!endsWith(n, "_FRAMES") && !endsWith(n, "_STRIDE");
+}
+
+//Directory id of an asset: CRC16 (xmodem) of its name, so it stays the
+//same from one image to the next
+static uint16_t assetId(const std::string &n)
+{
+	uint16_t crc = 0;
+	for(size_t i = 0; i < n.size(); i++) {
+		crc ^= (uint8_t)n[i] << 8;
+		for(int k = 0; k < 8; k++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+	return crc;
+}
+
+static uint16_t crcBytes(const Bytes &b)
+{
+	uint16_t crc = 0;
+	for(size_t i = 0; i < b.size(); i++) {
+		crc ^= b[i] << 8;
+		for(int k = 0; k < 8; k++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+	return crc;
+}
+
+struct Define {
+	std::string name;
+	long value;
+	std::string comment;
+};
+
+struct Builder {
+	Bytes img;
+	long align;
+	long zbmp;
+	long fontAt[3];
+	std::vector<Define> defs;
+	std::string dir;
+	long used; //bytes of assets, the directory comes after
+	long sizeFonts, sizeBmp, sizeAni, sizePad;
+
+	Builder() : align(1), zbmp(-1), used(0), sizeFonts(0), sizeBmp(0), sizeAni(0), sizePad(0) {
+		fontAt[0] = fontAt[1] = fontAt[2] = -1;
+	}
+
+	void pad(void) {
+		while(img.size() % align) {
+			img.push_back(0xFF); //erased EEPROM
+			sizePad++;
+		}
+	}
+
+	std::string path(const std::string &f) {
+		return ((f[0] == '/') || dir.empty()) ? f : dir + "/" + f;
+	}
+
+	bool font(const Words &w) {
+		int n, height;
+		std::map<int, Bytes> glyphs;
+		for(n = 0; n < 3; n++)
+			if(w[1] == fontName[n]) break;
+		if((n == 3) || (fontAt[n] >= 0) || (zbmp >= 0)) {
+			fprintf(stderr, "font %s: unknown, repeated or after the bitmaps\n", w[1].c_str());
+			return false;
+		}
+		if(!loadFont(path(w[2]), &height, glyphs)) return false;
+		if((height == 16) != (n == 2)) {
+			fprintf(stderr, "%s: font %s must be %d rows high\n", w[2].c_str(), fontName[n], (n == 2) ? 16 : 8);
+			return false;
+		}
+		pad();
+		fontAt[n] = img.size();
+		for(std::map<int, Bytes>::iterator g = glyphs.begin(); g != glyphs.end(); ++g) {
+			idx[n][g->first - FONT_FIRST].off = img.size();
+			idx[n][g->first - FONT_FIRST].wid = g->second[0];
+			img.insert(img.end(), g->second.begin(), g->second.end());
+			sizeFonts += g->second.size();
+		}
+		return true;
+	}
+
+	void startBitmaps(void) {
+		if(zbmp >= 0) return;
+		pad();
+		zbmp = img.size();
+	}
+
+	bool bmp(const Words &w, bool inGroup, long *size) {
+		uint8_t bw, bh;
+		Bytes rows;
+		bool packed = false;
+		int h = -1;
+		for(size_t i = 3; i < w.size(); i++) {
+			if(w[i] == "packed") packed = true;
+			else if(!w[i].compare(0, 2, "h=")) h = atoi(w[i].c_str() + 2);
+			else { fprintf(stderr, "%s: unknown option %s\n", w[1].c_str(), w[i].c_str()); return false; }
+		}
+		if(!loadBitmap(path(w[2]).c_str(), &bw, &bh, rows)) return false;
+		if((inGroup && packed) || (packed && (h >= 0)) || (h > 0xFF)) {
+			fprintf(stderr, "%s: packed doesn't go with groups or h=\n", w[1].c_str());
+			return false;
+		}
+		Bytes b = encode(bw, (h >= 0) ? h : bh, rows, packed);
+		startBitmaps();
+		if(!inGroup) pad();
+		defs.push_back((Define){w[1], (long)img.size() - zbmp, ""});
+		img.insert(img.end(), b.begin(), b.end());
+		sizeBmp += b.size();
+		*size = b.size();
+		return true;
+	}
+
+	bool ani(const Words &w) {
+		uint8_t fw, fh, kw, kh;
+		Bytes rows, cur, out;
+		int frames = w.size() - 2;
+		if(frames > 0xFF) { fprintf(stderr, "%s: too many frames\n", w[1].c_str()); return false; }
+		if(!loadBitmap(path(w[2]).c_str(), &kw, &kh, rows)) return false;
+		Bytes key = encode(kw, kh, rows, true);
+		out.push_back(frames);
+		out.push_back(key.size() & 0xFF);
+		out.push_back(key.size() >> 8);
+		out.insert(out.end(), key.begin(), key.end());
+		for(int n = 1; n < frames; n++) {
+			if(!loadBitmap(path(w[2 + n]).c_str(), &fw, &fh, cur)) return false;
+			if((fw != kw) || (fh != kh)) { fprintf(stderr, "%s: frames must all be %dx%d\n", w[2 + n].c_str(), kw, kh); return false; }
+			Bytes d = delta(kw, rows, cur);
+			if(d.empty()) return false;
+			out.insert(out.end(), d.begin(), d.end());
+			rows = cur;
+		}
+		startBitmaps();
+		pad();
+		defs.push_back((Define){w[1], (long)img.size() - zbmp, ""});
+		defs.push_back((Define){w[1] + "_FRAMES", frames, "animation"});
+		img.insert(img.end(), out.begin(), out.end());
+		sizeAni += out.size();
+		return true;
+	}
+
+	bool manifest(const char *name) {
+		char line[4096];
+		int lineNo = 0;
+		std::string group;
+		long start = 0, stride = 0, frames = 0, size;
+		FILE *f = fopen(name, "r");
+		if(!f) { fprintf(stderr, "can't open %s\n", name); return false; }
+		dir = name;
+		dir = (dir.find('/') == std::string::npos) ? "" : dir.substr(0, dir.rfind('/'));
+		while(fgets(line, sizeof(line), f)) {
+			lineNo++;
+			std::string s = line;
+			if(s.find('#') != std::string::npos) s.erase(s.find('#'));
+			Words w = split(s);
+			if(w.empty()) continue;
+			bool ok = true;
+			if((w[0] == "font") && (w.size() == 3)) ok = font(w);
+			else if((w[0] == "bmp") && (w.size() >= 3)) {
+				ok = bmp(w, !group.empty(), &size);
+				if(ok && !group.empty()) {
+					if(frames && (size != stride)) {
+						fprintf(stderr, "%s:%d: group %s frames must all be %ld bytes\n", name, lineNo, group.c_str(), stride);
+						ok = false;
+					}
+					stride = size;
+					frames++;
+				}
+			}
+			else if((w[0] == "ani") && (w.size() >= 3)) ok = ani(w);
+			else if((w[0] == "group") && (w.size() == 2) && group.empty()) {
+				group = w[1];
+				startBitmaps();
+				pad();
+				start = img.size() - zbmp;
+				frames = 0;
+			}
+			else if((w[0] == "end") && !group.empty()) {
+				bool named = false;
+				for(size_t i = 0; i < defs.size(); i++) named |= (defs[i].name == group);
+				if(!named) defs.push_back((Define){group, start, ""});
+				defs.push_back((Define){group + "_FRAMES", frames, ""});
+				defs.push_back((Define){group + "_STRIDE", stride, ""});
+				group.clear();
+			}
+			else {
+				fprintf(stderr, "%s:%d: can't make sense of this line\n", name, lineNo);
+				ok = false;
+			}
+			if(!ok) { fclose(f); return false; }
+		}
+		fclose(f);
+		if(!group.empty()) { fprintf(stderr, "%s: group %s has no end\n", name, group.c_str()); return false; }
+		for(int n = 0; n < 3; n++)
+			if(fontAt[n] < 0) { fprintf(stderr, "%s: font %s missing\n", name, fontName[n]); return false; }
+		startBitmaps();
+		used = img.size();
+		return true;
+	}
+
+	//The directory at ASSET_DIR, see P3310::assetLoad
+	bool directory(void) {
+		std::map<uint16_t, const Define *> dir;
+		for(size_t i = 0; i < defs.size(); i++) {
+			if(!isPlace(defs[i].name)) continue;
+			uint16_t id = assetId(defs[i].name);
+			if(dir.count(id)) {
+				fprintf(stderr, "%s and %s get the same id, rename one\n", dir[id]->name.c_str(), defs[i].name.c_str());
+				return false;
+			}
+			dir[id] = &defs[i];
+		}
+		Bytes d;
+		d.push_back(dir.size() & 0xFF);
+		d.push_back(dir.size() >> 8);
+		for(std::map<uint16_t, const Define *>::iterator e = dir.begin(); e != dir.end(); ++e) {
+			long a = zbmp + e->second->value;
+			d.push_back(e->first & 0xFF);
+			d.push_back(e->first >> 8);
+			d.push_back(a & 0xFF);
+			d.push_back(a >> 8);
+		}
+		uint16_t crc = crcBytes(d);
+		d.push_back(crc & 0xFF);
+		d.push_back(crc >> 8);
+		if((used > ASSET_DIR) || ((ASSET_DIR + (long)d.size()) > PGACalData)) return true; //build() complains
+		img.resize(ASSET_DIR, 0xFF);
+		img.insert(img.end(), d.begin(), d.end());
+		return true;
+	}
+};
+
+//The headers ship with the library, so they carry its license
+static const char license[] =
+	"/*\n"
+	"  Part of the library to handle various phone functions.\n"
+	"\n"
+	"    Copyright (C) 2015 Cristiano Griletti\n"
+	"\n"
+	"    This program is free software: you can redistribute it and/or modify\n"
+	"    it under the terms of the GNU General Public License as published by\n"
+	"    the Free Software Foundation, version 3.\n"
+	"\n"
+	"    This program is distributed in the hope that it will be useful,\n"
+	"    but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+	"    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+	"    GNU General Public License for more details.\n"
+	"\n"
+	"    You should have received a copy of the GNU General Public License\n"
+	"    along with this program.  If not, see <http://www.gnu.org/licenses/>.\n"
+	"*/\n\n";
+
+static bool writeBmpH(const std::string &name, const char *manifest, Builder &b)
+{
+	FILE *f = fopen(name.c_str(), "w");
+	if(!f) { fprintf(stderr, "can't create %s\n", name.c_str()); return false; }
+	fputs(license, f);
+	fprintf(f, "//Map of the assets in EEPROM, generated by tools/assetc from %s. Do not edit.\n", manifest);
+	fprintf(f, "//Bitmap and animation offsets are from idx_zbmp.\n\n");
+	fprintf(f, "#ifndef BMP_H_\n#define BMP_H_\n\n");
+	fprintf(f, "#define idx_font_l %ld\n", b.fontAt[2]);
+	fprintf(f, "#define idx_font_sb %ld\n", b.fontAt[0]);
+	fprintf(f, "#define idx_font_sp %ld\n", b.fontAt[1]);
+	fprintf(f, "#define idx_zbmp %ld\n", b.zbmp);
+	fprintf(f, "#define EEimage %ld //bytes used\n\n", b.used);
+	for(size_t i = 0; i < b.defs.size(); i++) {
+		fprintf(f, "#define %s %ld", b.defs[i].name.c_str(), b.defs[i].value);
+		if(!b.defs[i].comment.empty()) fprintf(f, " //%s", b.defs[i].comment.c_str());
+		fprintf(f, "\n");
+	}
+	fprintf(f, "\n//Directory ids for P3310::asset()\n");
+	for(size_t i = 0; i < b.defs.size(); i++)
+		if(isPlace(b.defs[i].name))
+			fprintf(f, "#define ASSET_%s 0x%04X\n", b.defs[i].name.c_str(), assetId(b.defs[i].name));
+	fprintf(f, "\n#endif\n");
+	fclose(f);
+	return true;
+}
+
+static bool writeFontIdx(const std::string &name)
+{
+	FILE *f = fopen(name.c_str(), "w");
+	if(!f) { fprintf(stderr, "can't create %s\n", name.c_str()); return false; }
+	fputs(license, f);
+	fprintf(f, "//Font character index, generated by tools/assetc. Do not edit.\n");
+	fprintf(f, "//EEPROM address of the width byte and width in columns of every char\n");
+	fprintf(f, "//from 0x%02X to 0x%02X; width 0 means the font doesn't have it.\n\n", FONT_FIRST, FONT_FIRST + FONT_CHARS - 1);
+	fprintf(f, "#ifndef FONTIDX_H_\n#define FONTIDX_H_\n\n");
+	fprintf(f, "#define FONT_FIRST 0x%02X\n#define FONT_CHARS 0x%02X\n\n", FONT_FIRST, FONT_CHARS);
+	fprintf(f, "struct FontChar{\n\tuint16_t off;\n\tuint8_t wid;\n};\n\n");
+	fprintf(f, "//0: small/bold, 1: small/plain, 2: large\n");
+	fprintf(f, "const FontChar PROGMEM fontIdx[3][FONT_CHARS] = {\n");
+	for(int n = 0; n < 3; n++) {
+		fprintf(f, "{");
+		for(int i = 0; i < FONT_CHARS; i++) {
+			if((i % 8) == 0) fprintf(f, "\n\t");
+			fprintf(f, "{%u, %u}, ", idx[n][i].off, idx[n][i].wid);
+		}
+		fprintf(f, "\n},\n");
+	}
+	fprintf(f, "};\n\n#endif\n");
+	fclose(f);
+	return true;
+}
+
+static int build(long align, const char *manifest, const char *image, const char *hdrDir)
+{
+	Builder b;
+	b.align = align;
+	if(!b.manifest(manifest) || !b.directory()) return 1;
+
+	long room = ASSET_DIR;
+	fprintf(stderr, "fonts       %6ld\n", b.sizeFonts);
+	fprintf(stderr, "bitmaps     %6ld\n", b.sizeBmp);
+	fprintf(stderr, "animations  %6ld\n", b.sizeAni);
+	fprintf(stderr, "padding     %6ld\n", b.sizePad);
+	fprintf(stderr, "total       %6ld of %ld (%ld free)\n", b.used, room, room - b.used);
+	fprintf(stderr, "directory   %6ld at 0x%04X\n", (long)b.img.size() - ASSET_DIR, ASSET_DIR);
+	if(b.used > room) {
+		fprintf(stderr, "the image runs into the asset directory\n");
+		return 1;
+	}
+	if((long)b.img.size() > PGACalData) {
+		fprintf(stderr, "the directory runs into the calibration data\n");
+		return 1;
+	}
+
+	FILE *f = fopen(image, "wb");
+	if(!f) { fprintf(stderr, "can't create %s\n", image); return 1; }
+	fwrite(&b.img[0], 1, b.img.size(), f);
+	fclose(f);
+
+	std::string m = manifest;
+	if(m.find('/') != std::string::npos) m = m.substr(m.rfind('/') + 1);
+	if(!writeBmpH(std::string(hdrDir) + "/bmp.h", m.c_str(), b)) return 1;
+	if(!writeFontIdx(std::string(hdrDir) + "/fontidx.h")) return 1;
+	return 0;
+}
+
+///Extracting
+
+static bool readFile(const char *name, std::string &s)
+{
+	FILE *f = fopen(name, "rb");
+	if(!f) { fprintf(stderr, "can't open %s\n", name); return false; }
+	int c;
+	while((c = fgetc(f)) != EOF) s += (char)c;
+	fclose(f);
+	return true;
+}
+
+struct Item {
+	std::string name;
+	long off;
+	bool operator<(const Item &o) const { return off < o.off; }
+};
+
+static int extract(const char *image, const char *bmpH, const char *fontH, const char *out)
+{
+	Bytes img;
+	std::string s, t;
+	std::map<std::string, long> def;
+	std::vector<Item> items;
+
+	if(!readFile(image, t)) return 1;
+	img.assign(t.begin(), t.end());
+
+	//the bitmap map, old hand written ones included
+	if(!readFile(bmpH, s)) return 1;
+	for(size_t p = 0; (p = s.find("#define", p)) != std::string::npos; p += 7) {
+		Words w = split(s.substr(p, s.find('\n', p) - p));
+		if((w.size() >= 3) && isdigit((unsigned char)w[2][0])) def[w[1]] = strtol(w[2].c_str(), 0, 0);
+	}
+	long zbmp = def.count("idx_zbmp") ? def["idx_zbmp"] : LEGACY_ZBMP;
+	for(std::map<std::string, long>::iterator d = def.begin(); d != def.end(); ++d) {
+		const std::string &n = d->first;
+		if(!isPlace(n)) continue;
+		if(def.count(n + "_STRIDE")) continue; //group name, not a bitmap
+		items.push_back((Item){n, d->second});
+	}
+	std::stable_sort(items.begin(), items.end());
+
+	//font index
+	s.clear();
+	if(!readFile(fontH, s)) return 1;
+	size_t p = s.find("fontIdx");
+	for(int n = 0; n < 3; n++)
+		for(int i = 0; i < FONT_CHARS; i++) {
+			p = s.find('{', p + 1);
+			while((p != std::string::npos) && !isdigit((unsigned char)s[p + 1])) p = s.find('{', p + 1);
+			if(p == std::string::npos) { fprintf(stderr, "%s: short font index\n", fontH); return 1; }
+			unsigned off, wid;
+			sscanf(s.c_str() + p, "{%u, %u}", &off, &wid);
+			idx[n][i].off = off;
+			idx[n][i].wid = wid;
+		}
+
+	std::string dir = out;
+	FILE *m = fopen((dir + "/assets.txt").c_str(), "w");
+	if(!m) { fprintf(stderr, "can't create %s/assets.txt\n", out); return 1; }
+	fprintf(m, "# extracted from %s by assetc -x\n\n", image);
+
+	//fonts in the order they are stored
+	int order[3] = {0, 1, 2};
+	long first[3];
+	for(int n = 0; n < 3; n++) {
+		first[n] = 0x7FFFFFFF;
+		for(int i = 0; i < FONT_CHARS; i++)
+			if(idx[n][i].wid && (idx[n][i].off < first[n])) first[n] = idx[n][i].off;
+	}
+	std::sort(order, order + 3, [&](int a, int b) { return first[a] < first[b]; });
+	for(int k = 0; k < 3; k++) {
+		int n = order[k];
+		std::string fn = std::string("font_") + fontName[n] + ".fnt";
+		if(!saveFont(dir + "/" + fn, (n == 2) ? 16 : 8, &img[0], img.size(), idx[n])) { fclose(m); return 1; }
+		fprintf(m, "font %s %s\n", fontName[n], fn.c_str());
+	}
+	fprintf(m, "\n");
+
+	//bitmaps, animations and groups by address
+	std::string group;
+	long groupEnd = 0;
+	for(size_t k = 0; k < items.size(); k++) {
+		const std::string &n = items[k].name;
+		long a = zbmp + items[k].off;
+		long next = (k + 1 < items.size()) ? zbmp + items[k + 1].off : (long)img.size();
+
+		for(std::map<std::string, long>::iterator d = def.begin(); d != def.end(); ++d)
+			if(endsWith(d->first, "_STRIDE")) {
+				std::string g = d->first.substr(0, d->first.size() - 7);
+				if(group.empty() && def.count(g) && (def[g] == items[k].off)) {
+					group = g;
+					groupEnd = a + def[g + "_FRAMES"] * d->second;
+					fprintf(m, "group %s\n", g.c_str());
+				}
+			}
+
+		if((a + 2) > (long)img.size()) { fprintf(stderr, "%s past the end of the image\n", n.c_str()); fclose(m); return 1; }
+		if(def.count(n + "_FRAMES")) {
+			//animation: rebuild every frame
+			int frames = img[a];
+			long key = img[a + 1] | (img[a + 2] << 8);
+			uint8_t w = img[a + 3] & ~BMP_PACKED, h = img[a + 4];
+			size_t size = ((h + 7) / 8) * w;
+			Bytes rows;
+			if(img[a + 3] & BMP_PACKED) unpackBits(&img[a + 5], key - 2, rows, size);
+			else rows.assign(img.begin() + a + 5, img.begin() + a + 5 + size);
+			fprintf(m, "ani %s", n.c_str());
+			long q = a + 3 + key;
+			for(int fno = 0; fno < frames; fno++) {
+				if(fno) {
+					int runs = img[q++];
+					while(runs--) {
+						long off = img[q] | (img[q + 1] << 8);
+						int len = img[q + 2];
+						q += 3;
+						for(int i = 0; (i < len) && ((size_t)(off + i) < size); i++) rows[off + i] ^= img[q + i];
+						q += len;
+					}
+				}
+				char fn[300];
+				snprintf(fn, sizeof(fn), "%s_%02d.pbm", n.c_str(), fno);
+				if(!saveBitmap(dir + "/" + fn, w, h, rows)) { fclose(m); return 1; }
+				fprintf(m, " %s", fn);
+			}
+			fprintf(m, "\n");
+			continue;
+		}
+
+		uint8_t w = img[a] & ~BMP_PACKED, h = img[a + 1];
+		bool packed = img[a] & BMP_PACKED;
+		Bytes rows;
+		int ph = h; //height of the image file
+		if(!w) { fprintf(stderr, "%s: zero width\n", n.c_str()); fclose(m); return 1; }
+		if(packed) {
+			if(!unpackBits(&img[a + 2], img.size() - a - 2, rows, ((h + 7) / 8) * w)) {
+				fprintf(stderr, "%s: bad packed data\n", n.c_str());
+				fclose(m);
+				return 1;
+			}
+		}
+		else {
+			//raw: old images sometimes hold the (h / 8) + 1 rows putBmp draws,
+			//the next one starts right after them then
+			long stored = (h + 7) / 8;
+			if((k + 1 < items.size()) && ((next - a - 2) == (((h / 8) + 1) * w))) stored = (h / 8) + 1;
+			if((a + 2 + stored * w) > (long)img.size()) stored = (img.size() - a - 2) / w;
+			rows.assign(img.begin() + a + 2, img.begin() + a + 2 + stored * w);
+			if(stored != (h + 7) / 8) ph = stored * 8;
+			//keep bits below h in the last row too, they are in the image
+			for(long x = (stored - 1) * w; (ph == h) && (h % 8) && (x < stored * w); x++)
+				if(rows[x] >> (h % 8)) ph = stored * 8;
+		}
+		char fn[300];
+		snprintf(fn, sizeof(fn), "%s.pbm", n.c_str());
+		if(!saveBitmap(dir + "/" + fn, w, ph, rows)) { fclose(m); return 1; }
+		fprintf(m, "%sbmp %s %s%s", group.empty() ? "" : "\t", n.c_str(), fn, packed ? " packed" : "");
+		if(ph != h) fprintf(m, " h=%d", h);
+		fprintf(m, "\n");
+
+		if(!group.empty() && (next >= groupEnd)) {
+			fprintf(m, "end\n");
+			group.clear();
+		}
+	}
+	fclose(m);
+	fprintf(stderr, "%u bitmaps and animations, manifest in %s/assets.txt\n", (unsigned)items.size(), out);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	long align = 1;
+	int a = 1;
+
+	if((argc == 6) && !strcmp(argv[1], "-x")) return extract(argv[2], argv[3], argv[4], argv[5]);
+	if((argc > a + 1) && !strcmp(argv[a], "-a")) {
+		align = atol(argv[a + 1]);
+		a += 2;
+	}
+	if(((argc - a) != 3) || (align < 1)) {
+		fprintf(stderr, "usage: assetc [-a align] assets.txt eeprom.bin headerdir\n");
+		fprintf(stderr, "       assetc -x eeprom.bin bmp.h fontidx.h outdir\n");
+		return 1;
+	}
+	return build(align, argv[a], argv[a + 1], argv[a + 2]);
+}
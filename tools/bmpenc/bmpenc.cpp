@@ -0,0 +1,114 @@
+/*
+  bmpenc - converts images to the bitmap format read by P3310::putBmp/blit
+
+  Build and run on the host:
+    g++ -O2 -o bmpenc bmpenc.cpp
+    ./bmpenc [-r] in.pbm|in.bin out.bin
+    ./bmpenc [-r] -a out.bin frame0 frame1 ...
+
+  Input is a PBM image (P1 or P4, black = 1) or a bitmap already in
+  EEPROM format (w, h, bank rows). Output is w|BMP_PACKED, h and the
+  PackBits compressed bank rows, or the raw rows when -r is given or
+  packing doesn't make it smaller.
+
+  With -a the frames, all the same size, become an animation for
+  P3310::aniStart/aniStep: frame count, keyframe length, the first frame
+  as above, then for every other frame the runs of bytes that changed,
+  XORed against the previous frame.
+
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../common/bitmap.h"
+
+static bool load(const char *name, uint8_t *w, uint8_t *h, Bytes &rows)
+{
+	FILE *f = fopen(name, "rb");
+	if(!f) { fprintf(stderr, "can't open %s\n", name); return false; }
+	if(!loadPBM(f, w, h, rows)) {
+		//not a PBM, try an EEPROM bitmap
+		rewind(f);
+		int cw = fgetc(f), ch = fgetc(f);
+		if((cw == EOF) || (ch == EOF) || (cw & BMP_PACKED)) { fprintf(stderr, "%s: unsupported input\n", name); fclose(f); return false; }
+		*w = cw;
+		*h = ch;
+		rows.assign(((ch + 7) / 8) * cw, 0);
+		if(fread(&rows[0], 1, rows.size(), f) != rows.size()) { fprintf(stderr, "%s: short bitmap\n", name); fclose(f); return false; }
+	}
+	fclose(f);
+	return true;
+}
+
+static bool save(const char *name, const Bytes &out)
+{
+	FILE *f = fopen(name, "wb");
+	if(!f) { fprintf(stderr, "can't create %s\n", name); return false; }
+	fwrite(&out[0], 1, out.size(), f);
+	fclose(f);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	bool raw = false, ani = false;
+	int a = 1;
+	uint8_t w, h;
+	Bytes rows;
+
+	if((argc > a) && !strcmp(argv[a], "-r")) { raw = true; a++; }
+	if((argc > a) && !strcmp(argv[a], "-a")) { ani = true; a++; }
+	if((ani && (argc - a < 2)) || (!ani && (argc - a != 2))) {
+		fprintf(stderr, "usage: bmpenc [-r] in.pbm|in.bin out.bin\n");
+		fprintf(stderr, "       bmpenc [-r] -a out.bin frame0 frame1 ...\n");
+		return 1;
+	}
+
+	if(!ani) {
+		if(!load(argv[a], &w, &h, rows)) return 1;
+		Bytes out = encode(w, h, rows, !raw);
+		if(!save(argv[a + 1], out)) return 1;
+		fprintf(stderr, "%dx%d: %u raw bytes, %u written\n", w, h, (unsigned)rows.size() + 2, (unsigned)out.size());
+		return 0;
+	}
+
+	int frames = argc - a - 1;
+	if(frames > 0xFF) { fprintf(stderr, "too many frames\n"); return 1; }
+	if(!load(argv[a + 1], &w, &h, rows)) return 1;
+	Bytes key = encode(w, h, rows, !raw);
+	Bytes out;
+	out.push_back(frames);
+	out.push_back(key.size() & 0xFF);
+	out.push_back(key.size() >> 8);
+	out.insert(out.end(), key.begin(), key.end());
+	unsigned full = rows.size() + 2;
+	for(int n = 1; n < frames; n++) {
+		uint8_t fw, fh;
+		Bytes cur;
+		if(!load(argv[a + 1 + n], &fw, &fh, cur)) return 1;
+		if((fw != w) || (fh != h)) { fprintf(stderr, "%s: frames must all be %dx%d\n", argv[a + 1 + n], w, h); return 1; }
+		Bytes d = delta(w, rows, cur);
+		if(d.empty()) return 1;
+		out.insert(out.end(), d.begin(), d.end());
+		rows = cur;
+		full += rows.size() + 2;
+	}
+	if(!save(argv[a], out)) return 1;
+	fprintf(stderr, "%d frames %dx%d: %u raw bytes, %u written\n", frames, w, h, full, (unsigned)out.size());
+	return 0;
+}
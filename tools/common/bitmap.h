@@ -0,0 +1,188 @@
+/*
+  bitmap.h - the bitmap format of P3310::putBmp/blit/aniStart on the host,
+  shared by tools/assetc, tools/bmpenc and tools/emu. Each of them is one
+  source file, so this is included, not linked.
+
+  A bitmap is w (|BMP_PACKED), h, then (h+7)/8 bank rows of w bytes, bit 0
+  on top, PackBits compressed when packed. An animation frame after the
+  first is a count of runs, then for each run its offset (lo, hi), length
+  and the bytes XORed against the previous frame.
+
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TOOLS_BITMAP_H
+#define TOOLS_BITMAP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <vector>
+
+#ifndef BMP_PACKED
+#define BMP_PACKED 0x80
+#endif
+
+typedef std::vector<uint8_t> Bytes;
+
+static inline int pbmInt(FILE *f)
+{
+	int c, v = 0;
+	do {
+		c = fgetc(f);
+		if(c == '#') while((c != '\n') && (c != EOF)) c = fgetc(f);
+	} while(isspace(c));
+	while(isdigit(c)) {
+		v = (v * 10) + (c - '0');
+		c = fgetc(f);
+	}
+	return v;
+}
+
+//Loads a PBM (P1 or P4, black = 1) into bank rows. false if it isn't one
+//or doesn't fit a bitmap, w up to 0x7F and h up to 0xFF.
+static inline bool loadPBM(FILE *f, uint8_t *w, uint8_t *h, Bytes &rows)
+{
+	int fmt, iw, ih;
+	if(fgetc(f) != 'P') return false;
+	fmt = fgetc(f);
+	if((fmt != '1') && (fmt != '4')) return false;
+	iw = pbmInt(f);
+	ih = pbmInt(f);
+	if((iw <= 0) || (iw > 0x7F) || (ih <= 0) || (ih > 0xFF)) return false;
+	*w = iw;
+	*h = ih;
+	rows.assign(((ih + 7) / 8) * iw, 0);
+	for(int y = 0; y < ih; y++) {
+		int bits = 0, acc = 0;
+		for(int x = 0; x < iw; x++) {
+			int px;
+			if(fmt == '1') {
+				int c;
+				do c = fgetc(f); while(isspace(c));
+				px = (c == '1');
+			}
+			else {
+				if(bits == 0) { acc = fgetc(f); bits = 8; }
+				px = (acc >> --bits) & 1;
+			}
+			if(px) rows[((y / 8) * iw) + x] |= 1 << (y % 8);
+		}
+	}
+	return true;
+}
+
+//Bank rows back to a P4 PBM
+static inline void savePBM(FILE *f, uint8_t w, uint8_t h, const Bytes &rows)
+{
+	fprintf(f, "P4\n%d %d\n", w, h);
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x += 8) {
+			uint8_t b = 0;
+			for(int k = 0; (k < 8) && ((x + k) < w); k++)
+				if((rows[((y / 8) * w) + x + k] >> (y % 8)) & 1) b |= 0x80 >> k;
+			fputc(b, f);
+		}
+}
+
+//PackBits: n >= 0 copies n+1 literal bytes, n < 0 repeats the next byte 1-n times
+static inline Bytes packBits(const Bytes &in)
+{
+	Bytes out;
+	size_t i = 0;
+	while(i < in.size()) {
+		size_t run = 1;
+		while(((i + run) < in.size()) && (in[i + run] == in[i]) && (run < 128)) run++;
+		if(run >= 2) {
+			out.push_back((uint8_t)(1 - (int)run));
+			out.push_back(in[i]);
+			i += run;
+			continue;
+		}
+		size_t start = i, n = 0;
+		while((i < in.size()) && (n < 128)) {
+			if(((i + 1) < in.size()) && (in[i + 1] == in[i])) break;
+			i++;
+			n++;
+		}
+		out.push_back((uint8_t)(n - 1));
+		out.insert(out.end(), in.begin() + start, in.begin() + i);
+	}
+	return out;
+}
+
+//Decodes n bytes, returns the packed bytes used or 0 if the data ends first
+static inline size_t unpackBits(const uint8_t *in, size_t len, Bytes &out, size_t n)
+{
+	size_t i = 0;
+	out.clear();
+	while(out.size() < n) {
+		if(i >= len) return 0;
+		int8_t hdr = in[i++];
+		if(hdr == -128) continue;
+		if(hdr >= 0) {
+			if((i + hdr + 1) > len) return 0;
+			out.insert(out.end(), in + i, in + i + hdr + 1);
+			i += hdr + 1;
+		}
+		else {
+			if(i >= len) return 0;
+			out.insert(out.end(), 1 - hdr, in[i++]);
+		}
+	}
+	out.resize(n);
+	return i;
+}
+
+//Bitmap in EEPROM format, packed if asked and packing helps
+static inline Bytes encode(uint8_t w, uint8_t h, const Bytes &rows, bool packed)
+{
+	Bytes out, p = packBits(rows);
+	if(packed && (p.size() < rows.size())) {
+		out.push_back(w | BMP_PACKED);
+		out.push_back(h);
+		out.insert(out.end(), p.begin(), p.end());
+	}
+	else {
+		out.push_back(w);
+		out.push_back(h);
+		out.insert(out.end(), rows.begin(), rows.end());
+	}
+	return out;
+}
+
+//Runs of changed bytes between two frames. Gaps shorter than a run header
+//are bridged, runs stop at the end of a bank row.
+static inline Bytes delta(uint8_t w, const Bytes &prev, const Bytes &cur)
+{
+	Bytes out(1, 0);
+	size_t i = 0;
+	while(i < cur.size()) {
+		if(cur[i] == prev[i]) { i++; continue; }
+		size_t start = i, end = i + 1, rowEnd = ((i / w) + 1) * w;
+		for(size_t k = end; (k < rowEnd) && (k - end <= 3); k++)
+			if(cur[k] != prev[k]) end = k + 1;
+		if(out[0] == 0xFF) { fprintf(stderr, "too many runs in one frame\n"); return Bytes(); }
+		out[0]++;
+		out.push_back(start & 0xFF);
+		out.push_back(start >> 8);
+		out.push_back(end - start);
+		for(size_t k = start; k < end; k++) out.push_back(cur[k] ^ prev[k]);
+		i = end;
+	}
+	return out;
+}
+
+#endif
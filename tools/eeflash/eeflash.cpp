@@ -0,0 +1,448 @@
+/*
+  eeflash - programs the asset EEPROM of a running phone over serial
+
+  Build and run on the host:
+    g++ -O2 -o eeflash eeflash.cpp
+    ./eeflash [-b baud] [-a addr] [-f] port image.bin
+    ./eeflash [-b baud] [-a addr] -d length port out.bin
+
+  Talks to EED2/eeflash.cpp, no special firmware build needed. First the
+  phone hashes the pages already in the chip and only the pages that
+  differ from the image are sent (-f sends everything). They go out in
+  chunks that never cross an EEPROM page, in order, so the phone fills
+  each page with one write and programs it while the next chunk travels.
+  The first whole page is read back to catch a chip with smaller pages
+  than the firmware expects. Damaged or lost frames are sent again. At
+  the end every 4K block is checked against a CRC computed by the phone
+  from what is really in the chip. -d reads the EEPROM back into a file
+  instead.
+
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <vector>
+
+#ifdef __linux__
+//termios2 lets Linux use any baud rate, asm/termbits.h clashes with termios.h
+#include <asm/ioctls.h>
+struct termios2{
+	tcflag_t c_iflag, c_oflag, c_cflag, c_lflag;
+	cc_t c_line;
+	cc_t c_cc[19];
+	speed_t c_ispeed, c_ospeed;
+};
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+#endif
+
+//Same as EED2/eeflash.h
+#define EEF_BAUD 250000
+#define EEF_SOF 0x7E
+#define EEF_INFO 'I'
+#define EEF_WRITE 'W'
+#define EEF_READ 'R'
+#define EEF_CRC 'C'
+#define EEF_HASH 'H'
+#define EEF_END 'E'
+#define EEF_ACK 'A'
+#define EEF_NAK 'N'
+#define EEF_VERSION 2
+#define EEF_ESIZE 4
+
+#define BLOCK 4096 //verified with one CRC
+#define RETRIES 5
+
+int fd;
+int chunk, page;
+long capacity;
+
+uint16_t crc16(uint16_t crc, const uint8_t *d, int n)
+{
+	while(n--)
+	{
+		crc ^= (uint16_t)*d++ << 8;
+		for(int i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+	return crc;
+}
+
+//avr-libc _crc_ccitt_update
+uint16_t ccitt(uint16_t crc, const uint8_t *d, int n)
+{
+	while(n--)
+	{
+		uint8_t b = *d++ ^ (crc & 0xFF);
+		b ^= b << 4;
+		crc = (((uint16_t)b << 8) | (crc >> 8)) ^ (uint8_t)(b >> 4) ^ ((uint16_t)b << 3);
+	}
+	return crc;
+}
+
+double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int openPort(const char *name, long baud)
+{
+	struct termios t;
+	
+	fd = open(name, O_RDWR | O_NOCTTY);
+	if(fd < 0) return 0;
+	if(tcgetattr(fd, &t) == 0)
+	{
+		cfmakeraw(&t);
+		t.c_cflag |= CLOCAL | CREAD;
+		t.c_cc[VMIN] = 0;
+		t.c_cc[VTIME] = 0;
+#ifndef __linux__
+		cfsetspeed(&t, baud);
+#endif
+		tcsetattr(fd, TCSANOW, &t);
+	}
+#ifdef __linux__
+	struct termios2 t2;
+	if(ioctl(fd, TCGETS2, &t2) == 0)
+	{
+		t2.c_cflag &= ~CBAUD;
+		t2.c_cflag |= BOTHER;
+		t2.c_ispeed = baud;
+		t2.c_ospeed = baud;
+		ioctl(fd, TCSETS2, &t2);
+	}
+#endif
+	return 1;
+}
+
+//Byte from the port, -1 after ms without one
+int getByte(int ms)
+{
+	struct pollfd p = {fd, POLLIN, 0};
+	uint8_t c;
+	
+	if(poll(&p, 1, ms) <= 0) return -1;
+	if(read(fd, &c, 1) != 1) return -1;
+	return c;
+}
+
+void sendFrame(uint8_t cmd, const uint8_t *d, int len)
+{
+	std::vector<uint8_t> f;
+	uint8_t hdr[2] = {cmd, (uint8_t)len};
+	uint16_t crc = crc16(crc16(0, hdr, 2), d, len);
+	
+	f.push_back(EEF_SOF);
+	f.push_back(cmd);
+	f.push_back(len);
+	f.insert(f.end(), d, d + len);
+	f.push_back(crc & 0xFF);
+	f.push_back(crc >> 8);
+	if(write(fd, &f[0], f.size()) != (ssize_t)f.size()) perror("write");
+}
+
+//Next good frame from the phone, its command or 0 on timeout. Boot
+//messages and damaged frames are skipped.
+int getFrame(uint8_t *d, int *len, int ms)
+{
+	int c, cmd, n;
+	uint8_t hdr[2];
+	
+	while((c = getByte(ms)) >= 0)
+	{
+		if(c != EEF_SOF) continue;
+		if((cmd = getByte(ms)) < 0) return 0;
+		if((n = getByte(ms)) < 0) return 0;
+		for(int i = 0; i < n; i++)
+			if((c = getByte(ms)) < 0) return 0;
+			else d[i] = c;
+		int lo = getByte(ms), hi = getByte(ms);
+		if(hi < 0) return 0;
+		hdr[0] = cmd;
+		hdr[1] = n;
+		if(crc16(crc16(0, hdr, 2), d, n) != (lo | (hi << 8))) continue;
+		*len = n;
+		return cmd;
+	}
+	return 0;
+}
+
+//Sends a command until it gets an answer that isn't a NAK
+int transact(uint8_t cmd, const uint8_t *d, int len, uint8_t *ans, int *alen, int ms)
+{
+	for(int t = 0; t < RETRIES; t++)
+	{
+		sendFrame(cmd, d, len);
+		int r = getFrame(ans, alen, ms);
+		if((r == EEF_NAK) && *alen && (ans[0] == EEF_ESIZE))
+		{
+			fprintf(stderr, "the EEPROM pages are smaller than EEF_PAGE in the firmware\n");
+			return 0;
+		}
+		if(r == EEF_NAK) fprintf(stderr, "NAK %d, again\n", *alen ? ans[0] : 0);
+		else if(r) return r;
+	}
+	return 0;
+}
+
+void put3(uint8_t *p, long v)
+{
+	p[0] = v & 0xFF;
+	p[1] = (v >> 8) & 0xFF;
+	p[2] = (v >> 16) & 0xFF;
+}
+
+int hello(void)
+{
+	uint8_t a[256];
+	int n;
+	
+	//the phone may be rebooting because opening the port toggled DTR
+	for(int t = 0; t < 10; t++)
+	{
+		sendFrame(EEF_INFO, 0, 0);
+		if((getFrame(a, &n, 500) == EEF_INFO) && (n >= 7)) break;
+		if(t == 9) return 0;
+	}
+	if(a[0] != EEF_VERSION)
+	{
+		fprintf(stderr, "protocol version %d, expected %d\n", a[0], EEF_VERSION);
+		return 0;
+	}
+	chunk = a[1];
+	page = a[2] | (a[3] << 8);
+	capacity = a[4] | (a[5] << 8) | ((long)a[6] << 16);
+	return 1;
+}
+
+//Marks the pages, or the partial ones at the ends, that differ from the chip
+int diff(const std::vector<uint8_t> &img, long base, std::vector<char> &dirty)
+{
+	uint8_t f[6], a[256];
+	int n;
+	long size = img.size();
+	long pos = 0, first = 0; //image offset of the first page boundary
+	
+	if(base % page) first = page - (base % page);
+	if(first > size) first = size;
+	
+	//partial pages are compared with a plain CRC of the range
+	long part[2][2] = {{0, first}, {first + ((size - first) / page) * page, size}};
+	for(int k = 0; k < 2; k++)
+	{
+		long len = part[k][1] - part[k][0];
+		if(len <= 0) continue;
+		put3(f, base + part[k][0]);
+		put3(f + 3, len);
+		if((transact(EEF_CRC, f, 6, a, &n, 2000) != EEF_CRC) || (n != 2)) return 0;
+		if((a[0] | (a[1] << 8)) != crc16(0, &img[part[k][0]], len))
+			for(long i = part[k][0]; i < part[k][1]; i++) dirty[i] = 1;
+	}
+	
+	//whole pages by hash, as many as fit in an answer
+	for(pos = first; (pos + page) <= size; )
+	{
+		int cnt = (size - pos) / page;
+		if(cnt > chunk / 4) cnt = chunk / 4;
+		put3(f, base + pos);
+		f[3] = cnt;
+		if((transact(EEF_HASH, f, 4, a, &n, 2000) != EEF_HASH) || (n != cnt * 4)) return 0;
+		for(int p = 0; p < cnt; p++, pos += page)
+		{
+			uint16_t x = a[p * 4] | (a[p * 4 + 1] << 8);
+			uint16_t c = a[p * 4 + 2] | (a[p * 4 + 3] << 8);
+			if((x != crc16(0, &img[pos], page)) || (c != ccitt(0xFFFF, &img[pos], page)))
+				memset(&dirty[pos], 1, page);
+		}
+	}
+	return 1;
+}
+
+int writeImage(const std::vector<uint8_t> &img, long base, const std::vector<char> &dirty)
+{
+	uint8_t f[300], a[256];
+	int n;
+	long pos = 0;
+	
+	while(pos < (long)img.size())
+	{
+		long addr = base + pos;
+		long len = page - (addr % page); //stay inside the page
+		if(len > chunk) len = chunk;
+		if(len > (long)img.size() - pos) len = img.size() - pos;
+		if(!dirty[pos])
+		{
+			pos += len;
+			continue;
+		}
+		put3(f, addr);
+		memcpy(f + 3, &img[pos], len);
+		if(transact(EEF_WRITE, f, len + 3, a, &n, 500) != EEF_ACK)
+		{
+			fprintf(stderr, "\nwrite at 0x%06lX failed\n", addr);
+			return 0;
+		}
+		pos += len;
+		if((pos % BLOCK) == 0) fprintf(stderr, "\r%ld/%ld", pos, (long)img.size());
+	}
+	fprintf(stderr, "\r%ld/%ld\n", pos, (long)img.size());
+	return 1;
+}
+
+int verify(const std::vector<uint8_t> &img, long base)
+{
+	uint8_t f[6], a[256];
+	int n, bad = 0;
+	
+	for(long pos = 0; pos < (long)img.size(); pos += BLOCK)
+	{
+		long len = img.size() - pos;
+		if(len > BLOCK) len = BLOCK;
+		put3(f, base + pos);
+		put3(f + 3, len);
+		if((transact(EEF_CRC, f, 6, a, &n, 2000) != EEF_CRC) || (n != 2))
+		{
+			fprintf(stderr, "no CRC for 0x%06lX\n", base + pos);
+			return 0;
+		}
+		if((a[0] | (a[1] << 8)) != crc16(0, &img[pos], len))
+		{
+			fprintf(stderr, "block 0x%06lX differs\n", base + pos);
+			bad++;
+		}
+	}
+	return bad == 0;
+}
+
+int dump(FILE *out, long base, long size)
+{
+	uint8_t f[4], a[256];
+	int n;
+	
+	for(long pos = 0; pos < size; pos += n)
+	{
+		long len = size - pos;
+		if(len > chunk) len = chunk;
+		put3(f, base + pos);
+		f[3] = len;
+		if((transact(EEF_READ, f, 4, a, &n, 500) != EEF_READ) || (n != len))
+		{
+			fprintf(stderr, "read at 0x%06lX failed\n", base + pos);
+			return 0;
+		}
+		fwrite(a, 1, n, out);
+	}
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	long baud = EEF_BAUD, base = 0, dumpLen = -1;
+	int i, ok, n, full = 0;
+	uint8_t a[256];
+	
+	for(i = 1; (i < argc) && (argv[i][0] == '-'); i++)
+	{
+		if(!strcmp(argv[i], "-f"))
+		{
+			full = 1;
+			continue;
+		}
+		if((i + 1) >= argc) break;
+		if(!strcmp(argv[i], "-b")) baud = atol(argv[++i]);
+		else if(!strcmp(argv[i], "-a")) base = strtol(argv[++i], 0, 0);
+		else if(!strcmp(argv[i], "-d")) dumpLen = strtol(argv[++i], 0, 0);
+		else break;
+	}
+	if((argc - i) != 2)
+	{
+		fprintf(stderr, "usage: %s [-b baud] [-a addr] [-f] port image.bin\n", argv[0]);
+		fprintf(stderr, "       %s [-b baud] [-a addr] -d length port out.bin\n", argv[0]);
+		return 2;
+	}
+	
+	if(!openPort(argv[i], baud))
+	{
+		perror(argv[i]);
+		return 1;
+	}
+	if(!hello())
+	{
+		fprintf(stderr, "no answer from the phone\n");
+		return 1;
+	}
+	fprintf(stderr, "EEPROM %ld bytes, %d byte pages, %d byte chunks\n", capacity, page, chunk);
+	
+	double t0 = now();
+	if(dumpLen >= 0)
+	{
+		FILE *out = fopen(argv[i + 1], "wb");
+		if(!out)
+		{
+			perror(argv[i + 1]);
+			return 1;
+		}
+		ok = dump(out, base, dumpLen);
+		fclose(out);
+		if(ok) fprintf(stderr, "%ld bytes read", dumpLen);
+	}
+	else
+	{
+		std::vector<uint8_t> img;
+		FILE *in = fopen(argv[i + 1], "rb");
+		if(!in)
+		{
+			perror(argv[i + 1]);
+			return 1;
+		}
+		int c;
+		while((c = fgetc(in)) != EOF) img.push_back(c);
+		fclose(in);
+		if((base + (long)img.size()) > capacity)
+		{
+			fprintf(stderr, "image ends at 0x%06lX, past the EEPROM\n", base + (long)img.size());
+			return 1;
+		}
+		std::vector<char> dirty(img.size(), full);
+		ok = full || diff(img, base, dirty);
+		long changed = 0;
+		for(long k = 0; k < (long)img.size(); k++) changed += dirty[k];
+		if(ok) fprintf(stderr, "%ld of %ld bytes to write\n", changed, (long)img.size());
+		ok = ok && writeImage(img, base, dirty) && verify(img, base);
+		if(ok) fprintf(stderr, "%ld bytes written and verified", changed);
+	}
+	double t = now() - t0;
+	transact(EEF_END, 0, 0, a, &n, 2000);
+	if(!ok)
+	{
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+	fprintf(stderr, " in %.1f s\n", t);
+	return 0;
+}
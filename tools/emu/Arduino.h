@@ -0,0 +1,64 @@
+/*
+  Host stand-in for the parts of the Arduino core the p3310 library uses.
+  Pins, SPI and timing are emulated in emu.cpp.
+*/
+
+#ifndef EMU_ARDUINO_H_
+#define EMU_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define EXTERNAL 0
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+void analogReference(uint8_t mode);
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void _delay_ms(double ms);
+void tone(uint8_t pin, unsigned int freq, unsigned long dur = 0);
+void noTone(uint8_t pin);
+
+class HardwareSerial
+{
+	public:
+	void begin(long baud) {}
+	int available(void) { return 0; }
+	int read(void) { return -1; }
+	size_t write(uint8_t c) { return fputc(c, stderr) != EOF; }
+	void print(const char *s) { fputs(s, stderr); }
+	void print(long v, int base = 10) { fprintf(stderr, base == 16 ? "%lX" : "%ld", v); }
+	void println(const char *s) { fprintf(stderr, "%s\n", s); }
+	void println(long v, int base = 10) { print(v, base); fputc('\n', stderr); }
+	void println(void) { fputc('\n', stderr); }
+};
+extern HardwareSerial Serial;
+
+#include <avr/pgmspace.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#endif
@@ -0,0 +1,23 @@
+//Host stand-in for the Arduino SPI library, transfers go to emu.cpp
+#ifndef EMU_SPI_H_
+#define EMU_SPI_H_
+
+#include <stdint.h>
+
+#define SPI_CLOCK_DIV2 0x04
+#define SPI_CLOCK_DIV4 0x00
+#define SPI_MODE0 0x00
+#define MSBFIRST 1
+
+class SPIClass
+{
+	public:
+	void begin(void) {}
+	void setClockDivider(uint8_t div) {}
+	void setDataMode(uint8_t mode) {}
+	void setBitOrder(uint8_t order) {}
+	uint8_t transfer(uint8_t data);
+};
+extern SPIClass SPI;
+
+#endif
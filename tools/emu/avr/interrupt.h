@@ -0,0 +1,12 @@
+//Host stand-in: interrupt vectors are plain functions called by the emulator
+#ifndef EMU_INTERRUPT_H_
+#define EMU_INTERRUPT_H_
+
+#define ISR(vector) extern "C" void vector(void)
+#define SPI_STC_vect emu_SPI_STC_vect
+#define ADC_vect emu_ADC_vect
+
+void cli(void);
+void sei(void);
+
+#endif
@@ -0,0 +1,51 @@
+//Host stand-in for the AVR registers the library touches
+#ifndef EMU_IO_H_
+#define EMU_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t SREG;
+extern volatile uint8_t SPCR;
+extern volatile uint8_t SPSR;
+
+//Writing SPDR clocks a byte out on the emulated bus
+struct EmuSPDR{
+	uint8_t val;
+	uint8_t pending;
+	void operator=(uint8_t b) volatile;
+	operator uint8_t() const volatile { return val; }
+};
+extern volatile EmuSPDR SPDR;
+
+//Port C is A0-A5, setting or clearing bits drives the emulated pins
+struct EmuPort{
+	uint8_t pin0; //pin of bit 0
+	void operator|=(uint8_t m) volatile;
+	void operator&=(uint8_t m) volatile;
+};
+extern volatile EmuPort PORTC;
+
+#define SPIE 7
+#define SPE 6
+#define SPIF 7
+
+//ADC and Timer1, enough for the PGA sampling engine: while Timer1 runs and
+//the ADC is set to auto trigger with its interrupt on, the emulator converts
+//every OCR1A+1 timer ticks as time goes by
+#define F_CPU 16000000UL
+extern volatile uint8_t ADMUX, ADCSRA, ADCSRB, TCCR1A, TCCR1B, TIFR1;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B, ADC;
+
+#define ADTS0 0
+#define ADTS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define CS11 1
+#define WGM12 3
+#define OCF1B 2
+
+#define _BV(b) (1 << (b))
+
+#endif
@@ -0,0 +1,16 @@
+//Host stand-in: flash and RAM are the same thing here
+#ifndef EMU_PGMSPACE_H_
+#define EMU_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_byte_near(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_word_near(p) (*(const uint16_t *)(p))
+#define memcpy_P memcpy
+
+#endif
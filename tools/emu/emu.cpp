@@ -0,0 +1,317 @@
+/*
+  Host emulation of the 3310 board, see emu.h.
+*/
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <spieeprom.h>
+#include <p3310.h>
+#include "emu.h"
+
+EmuLCD emuLCD;
+EmuStats emuStats;
+uint8_t emuEEPROM[EMU_EESIZE];
+int emuAnalog[20];
+EmuPGA emuPGA;
+int (*emuADC)(uint8_t ch, uint8_t gain);
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+volatile uint8_t SREG;
+volatile uint8_t SPCR;
+volatile uint8_t SPSR;
+volatile EmuSPDR SPDR;
+volatile EmuPort PORTC = {14}; //A0
+volatile uint8_t ADMUX, ADCSRA, ADCSRB, TCCR1A, TCCR1B, TIFR1;
+volatile uint16_t TCNT1, OCR1A, OCR1B, ADC;
+
+static uint8_t pins[20];
+static unsigned long now; //microseconds
+static unsigned long nextConv; //microseconds, next timed ADC conversion
+static uint8_t pgaIdx; //bytes since OP_CS went low
+
+///GPIO and time
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+static void eeDeselect(void);
+extern "C" void ADC_vect(void) __attribute__((weak)); //only when PGA.cpp is linked in
+
+//Moves the clock on, running the timed conversions that fall in between
+static void advance(unsigned long us)
+{
+	unsigned long end = now + us, period;
+	
+	while(1)
+	{
+		if(!(TCCR1B & 0x07) || !(ADCSRA & _BV(ADATE)) || !(ADCSRA & _BV(ADIE)))
+		{
+			nextConv = 0;
+			break;
+		}
+		period = ((OCR1A + 1UL) * 8 * 1000000UL) / F_CPU;
+		if(!nextConv) nextConv = now + period;
+		if(nextConv > end) break;
+		now = nextConv;
+		nextConv += period;
+		int v = emuADC ? emuADC(emuPGA.ch, emuPGA.gain) : 0;
+		ADC = (v < 0) ? 0 : (v > 1023) ? 1023 : v;
+		if(ADC_vect) ADC_vect();
+	}
+	now = end;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	if(pin >= 20) return;
+	if((pin == EE_CS) && val && !pins[pin]) eeDeselect();
+	if((pin == EE_CS) && !val && pins[pin]) emuStats.eeSelects++;
+	if(pin == OP_CS) pgaIdx = 0;
+	pins[pin] = val;
+}
+
+void EmuPort::operator|=(uint8_t m) volatile
+{
+	for(uint8_t b = 0; b < 8; b++)
+		if(m & (1 << b)) digitalWrite(pin0 + b, HIGH);
+}
+
+void EmuPort::operator&=(uint8_t m) volatile
+{
+	for(uint8_t b = 0; b < 8; b++)
+		if(!(m & (1 << b))) digitalWrite(pin0 + b, LOW);
+}
+
+int digitalRead(uint8_t pin) { return (pin < 20) ? pins[pin] : 0; }
+int analogRead(uint8_t pin) { return (pin < 20) ? emuAnalog[pin] : 0; }
+void analogWrite(uint8_t pin, int val) {}
+void analogReference(uint8_t mode) {}
+//Reading the clock costs a little, so polling loops see time go by
+unsigned long millis(void) { advance(4); return now / 1000; }
+unsigned long micros(void) { advance(4); return now; }
+void delay(unsigned long ms) { advance(ms * 1000); }
+void delayMicroseconds(unsigned int us) { advance(us); }
+void _delay_ms(double ms) { advance((unsigned long)(ms * 1000)); }
+void tone(uint8_t pin, unsigned int freq, unsigned long dur) {}
+void noTone(uint8_t pin) {}
+void cli(void) {}
+void sei(void) {}
+
+///PCD8544
+static void lcdByte(uint8_t b)
+{
+	EmuLCD *l = &emuLCD;
+	
+	if(pins[LCD_DC])
+	{
+		emuStats.data++;
+		l->ram[l->y][l->x] = b;
+		if(l->vertical)
+		{
+			if(++l->y > 5) { l->y = 0; if(++l->x > 83) l->x = 0; }
+		}
+		else if(++l->x > 83) { l->x = 0; if(++l->y > 5) l->y = 0; }
+		return;
+	}
+	
+	emuStats.cmds++;
+	if((b & 0xF8) == PCD8544_FUNCTIONSET)
+	{
+		l->ext = b & PCD8544_EXTENDEDINSTRUCTION;
+		l->vertical = b & PCD8544_ENTRYMODE;
+		return;
+	}
+	if(l->ext)
+	{
+		if(b & PCD8544_SETVOP) l->vop = b & 0x7F;
+		else if((b & 0xF8) == PCD8544_SETBIAS) l->bias = b & 0x07;
+		return;
+	}
+	if(b & PCD8544_SETXADDR) l->x = (b & 0x7F) % 84;
+	else if((b & 0xF8) == PCD8544_SETYADDR) l->y = (b & 0x07) % 6;
+	else if((b & 0xF8) == PCD8544_DISPLAYCONTROL) l->mode = b & 0x05;
+}
+
+uint8_t emuPixel(uint8_t x, uint8_t y)
+{
+	uint8_t p = (emuLCD.ram[y / 8][x] >> (y % 8)) & 1;
+	switch(emuLCD.mode)
+	{
+		case PCD8544_DISPLAYBLANK: return 0;
+		case PCD8544_DISPLAYALLON: return 1;
+		case PCD8544_DISPLAYINVERTED: return !p;
+	}
+	return p;
+}
+
+///SPI EEPROM, 24 bit addresses like SPIEEPROM type 1
+static uint8_t eeOp, eeAddrBytes, eeWren;
+static long eeAddr;
+
+static void eeDeselect(void)
+{
+	if(eeOp == 0x02) eeWren = 0; //a write cycle clears WEL
+	eeOp = 0;
+	eeAddrBytes = 0;
+}
+
+static uint8_t eeByte(uint8_t b)
+{
+	emuStats.eeBytes++;
+	if(eeOp == 0)
+	{
+		eeOp = b;
+		eeAddr = 0;
+		if(b == 0x06) eeWren = 1;
+		if(b == 0x04) eeWren = 0;
+		return 0xFF;
+	}
+	if(eeOp == 0x05) return eeWren ? 0x02 : 0x00; //never busy
+	if((eeOp != 0x02) && (eeOp != 0x03)) return 0xFF;
+	if(eeAddrBytes < 3)
+	{
+		eeAddr = (eeAddr << 8) | b;
+		eeAddrBytes++;
+		return 0xFF;
+	}
+	if(eeOp == 0x03) return emuEEPROM[eeAddr++ % EMU_EESIZE];
+	if(eeWren)
+	{
+		emuEEPROM[eeAddr % EMU_EESIZE] = b;
+		eeAddr = (eeAddr & ~0xFFL) | ((eeAddr + 1) & 0xFF); //wraps inside the page
+	}
+	return 0xFF;
+}
+
+///SPI bus
+uint8_t SPIClass::transfer(uint8_t data)
+{
+	uint8_t r = 0xFF;
+	if(!pins[LCD_CS]) lcdByte(data);
+	if(!pins[EE_CS]) r = eeByte(data);
+	if(!pins[OP_CS])
+	{
+		emuStats.pgaBytes++;
+		if((pgaIdx++ == 1) && ((data & 0x0F) < 2)) //after the 0x2A write command
+		{
+			emuPGA.gain = (data >> 4) & 0x07;
+			emuPGA.ch = data & 0x0F;
+		}
+	}
+	return r;
+}
+
+//A write to SPDR clocks the byte out at once; with SPIE set the transfer
+//complete interrupt runs right after, until it stops writing SPDR
+extern "C" void SPI_STC_vect(void);
+
+void EmuSPDR::operator=(uint8_t b) volatile
+{
+	static uint8_t inIsr;
+	val = SPI.transfer(b);
+	if(!(SPCR & _BV(SPIE)) || inIsr) { pending = inIsr; return; }
+	inIsr = 1;
+	do {
+		pending = 0;
+		SPI_STC_vect();
+	} while(pending && (SPCR & _BV(SPIE)));
+	inIsr = 0;
+}
+
+///SPIEEPROM library
+void SPIEEPROM::send_address(long addr)
+{
+	SPI.transfer((addr >> 16) & 0xFF);
+	SPI.transfer((addr >> 8) & 0xFF);
+	SPI.transfer(addr & 0xFF);
+}
+
+void SPIEEPROM::start_write(void)
+{
+	digitalWrite(SLAVESELECT, LOW);
+	SPI.transfer(0x06);
+	digitalWrite(SLAVESELECT, HIGH);
+	digitalWrite(SLAVESELECT, LOW);
+	SPI.transfer(0x02);
+}
+
+void SPIEEPROM::write(long addr, byte data)
+{
+	write(addr, &data, 1);
+}
+
+void SPIEEPROM::write(long addr, byte data[], int arrLength)
+{
+	start_write();
+	send_address(addr);
+	for(int i = 0; i < arrLength; i++) SPI.transfer(data[i]);
+	digitalWrite(SLAVESELECT, HIGH);
+}
+
+byte SPIEEPROM::read_byte(long addr)
+{
+	byte b;
+	read_mem(addr, &b, 1);
+	return b;
+}
+
+void SPIEEPROM::read_mem(long addr, byte buffer[], int length)
+{
+	digitalWrite(SLAVESELECT, LOW);
+	SPI.transfer(0x03);
+	send_address(addr);
+	for(int i = 0; i < length; i++) buffer[i] = SPI.transfer(0xFF);
+	digitalWrite(SLAVESELECT, HIGH);
+}
+
+///Files
+long emuLoadEEPROM(const char *file)
+{
+	FILE *f = fopen(file, "rb");
+	if(!f) return -1;
+	long n = fread(emuEEPROM, 1, EMU_EESIZE, f);
+	fclose(f);
+	return n;
+}
+
+int emuWritePBM(const char *file)
+{
+	FILE *f = fopen(file, "wb");
+	if(!f) return 0;
+	fprintf(f, "P4\n84 48\n");
+	for(uint8_t y = 0; y < 48; y++)
+		for(uint8_t x = 0; x < 84; x += 8)
+		{
+			uint8_t b = 0;
+			for(uint8_t k = 0; k < 8; k++)
+				if(((x + k) < 84) && emuPixel(x + k, y)) b |= 0x80 >> k;
+			fputc(b, f);
+		}
+	fclose(f);
+	return 1;
+}
+
+long emuComparePBM(const char *file)
+{
+	char hdr[3] = {0};
+	int w, h;
+	long diff = 0;
+	FILE *f = fopen(file, "rb");
+	if(!f) return -1;
+	if((fscanf(f, "%2s %d %d", hdr, &w, &h) != 3) || strcmp(hdr, "P4") || (w != 84) || (h != 48))
+	{
+		fclose(f);
+		return -1;
+	}
+	fgetc(f);
+	for(uint8_t y = 0; y < 48; y++)
+		for(uint8_t x = 0; x < 84; x += 8)
+		{
+			int b = fgetc(f);
+			if(b == EOF) { fclose(f); return -1; }
+			for(uint8_t k = 0; (k < 8) && ((x + k) < 84); k++)
+				if(((b >> (7 - k)) & 1) != emuPixel(x + k, y)) diff++;
+		}
+	fclose(f);
+	return diff;
+}
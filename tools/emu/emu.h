@@ -0,0 +1,53 @@
+/*
+  Host emulation of the 3310 board: GPIO, SPI bus, a PCD8544 LCD that
+  decodes the command/data stream into a virtual 84x48 panel, the SPI
+  EEPROM holding fonts and bitmaps, and the PGA113 with the ADC behind it.
+*/
+
+#ifndef EMU_H_
+#define EMU_H_
+
+#include <stdint.h>
+
+#define EMU_EESIZE 0x20000
+
+struct EmuLCD{
+	uint8_t ram[6][84]; //display RAM, bank rows like lcd_buffer
+	uint8_t x, y;
+	uint8_t ext; //H bit of the last FUNCTIONSET
+	uint8_t vertical; //V bit, vertical addressing
+	uint8_t mode; //DISPLAYCONTROL D and E bits
+	uint8_t vop, bias;
+};
+
+struct EmuStats{
+	unsigned long data; //LCD data bytes
+	unsigned long cmds; //LCD command bytes
+	unsigned long eeBytes; //bytes clocked while the EEPROM was selected
+	unsigned long eeSelects; //EEPROM transactions
+	unsigned long pgaBytes;
+};
+
+extern EmuLCD emuLCD;
+extern EmuStats emuStats;
+extern uint8_t emuEEPROM[EMU_EESIZE];
+extern int emuAnalog[20]; //analogRead() values by pin
+
+//PGA113 state as last written over SPI
+struct EmuPGA{
+	uint8_t gain; //0-7
+	uint8_t ch;
+};
+extern EmuPGA emuPGA;
+//ADC code (0-1023) of a timed conversion, for the PGA channel and gain
+//set at that moment. Without it timed conversions read 0.
+extern int (*emuADC)(uint8_t ch, uint8_t gain);
+
+long emuLoadEEPROM(const char *file);
+//Visible panel pixels (1 = black), honouring blank/all on/inverted modes
+uint8_t emuPixel(uint8_t x, uint8_t y);
+int emuWritePBM(const char *file);
+//Number of pixels that differ from a PBM file, -1 if it can't be read
+long emuComparePBM(const char *file);
+
+#endif
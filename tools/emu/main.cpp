@@ -0,0 +1,277 @@
+/*
+  p3310emu - runs the P3310 library on the host against an emulated
+  PCD8544 and SPI EEPROM, and dumps what the panel shows.
+
+  Build and run from the repository root:
+    g++ -O2 -I tools/emu -I p3310 -I EED2 -o p3310emu tools/emu/emu.cpp tools/emu/main.cpp p3310/p3310.cpp EED2/eecache.cpp
+    ./p3310emu [-e eeprom.bin] [-g goldendir|-] [-o outdir]
+
+  tools/emu/variants.sh runs it again with the optional features on.
+
+  Every scene is drawn with the normal drawing calls and pushed with
+  display() or displayAsync(). The emulated LCD decodes the command and
+  data bytes exactly as the controller would, and the bytes each frame
+  took are listed. A panel that doesn't match lcd_buffer means the
+  driver lost track of what it sent. The packed scene also checks the
+  PackBits decoder against the rows it packed, and the stream scene
+  draws the same bitmaps through the EEPROM hooks and through an
+  EEStream, which must agree.
+
+  The EEPROM image (-e, tools/emu/ref/eeprom.bin by default) gives the
+  text scenes their fonts. Every frame is compared to
+  goldendir/frame_NN.pbm (tools/emu/ref by default, - to skip). The exit
+  status is 1 on any difference or missing golden, 2 when the image
+  can't be read. With -o the panel of every frame is written to
+  outdir/frame_NN.pbm; -o tools/emu/ref -g - updates the goldens.
+
+  tools/emu/ref/eeprom.bin is the font part of an assetc image, 1855
+  bytes at the offsets of p3310/fontidx.h. Its glyphs are random stand-in
+  data, not the phone's fonts: they only have to be the same on every
+  run.
+
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <p3310.h>
+#include "eecache.h"
+#include "emu.h"
+#include "../common/bitmap.h"
+
+P3310 phone;
+SPIEEPROM disk1(1);
+
+static const char *image = "tools/emu/ref/eeprom.bin";
+static const char *goldDir = "tools/emu/ref";
+static const char *outDir;
+static int nFrame, failed;
+
+#define PACKED_AT 0xE000 //past the assets, test bitmaps go here
+#define RAW_AT (PACKED_AT + 0x600)
+
+//Checks and dumps the panel after a frame went out
+static void frame(const char *name, EmuStats *from)
+{
+	char path[512];
+	long bad = 0;
+	
+	for(uint8_t b = 0; b < LCDHEIGHT / 8; b++)
+		for(uint8_t x = 0; x < LCDWIDTH; x++)
+			if(emuLCD.ram[b][x] != phone.lcd_buffer[b * LCDWIDTH + x]) bad++;
+	
+	printf("frame_%02d %-12s data %4lu cmds %3lu ee %5lu", nFrame, name,
+		emuStats.data - from->data, emuStats.cmds - from->cmds, emuStats.eeBytes - from->eeBytes);
+	if(bad) { printf("  PANEL != lcd_buffer (%ld bytes)", bad); failed = 1; }
+	
+	if(outDir)
+	{
+		snprintf(path, sizeof(path), "%s/frame_%02d.pbm", outDir, nFrame);
+		if(!emuWritePBM(path)) { printf("  can't write %s", path); failed = 1; }
+	}
+	if(goldDir)
+	{
+		snprintf(path, sizeof(path), "%s/frame_%02d.pbm", goldDir, nFrame);
+		long d = emuComparePBM(path);
+		if(d < 0) { printf("  no golden"); failed = 1; }
+		else if(d) { printf("  %ld px differ", d); failed = 1; }
+	}
+	printf("\n");
+	nFrame++;
+	*from = emuStats;
+}
+
+//A screen of everything that reads bitmaps from the EEPROM: a prefetched
+//raw bitmap, a packed one, blits at pixel positions and an animation
+static void drawMixed(void)
+{
+	AniPlayer ani;
+	
+	phone.clearDisplay();
+	phone.bmpPrefetch(RAW_AT - idx_zbmp);
+	while(!phone.bmpPrefetchStep());
+	phone.putBmp(RAW_AT - idx_zbmp, 0, 2);
+	phone.putBmp(PACKED_AT + 0x500 - idx_zbmp, 2, 30);
+	phone.blit(RAW_AT - idx_zbmp, 50, 3);
+	phone.blit(PACKED_AT + 0x500 - idx_zbmp, 40, 30, BLIT_XOR);
+	phone.aniStart(&ani, PACKED_AT + 0x400 - idx_zbmp, 4, 2);
+	while(phone.aniStep(&ani));
+}
+
+int main(int argc, char **argv)
+{
+	EmuStats s;
+	
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "-e") && (i + 1 < argc)) image = argv[++i];
+		else if(!strcmp(argv[i], "-o") && (i + 1 < argc)) outDir = argv[++i];
+		else if(!strcmp(argv[i], "-g") && (i + 1 < argc)) goldDir = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: %s [-e eeprom.bin] [-g goldendir|-] [-o outdir]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(!strcmp(goldDir, "-")) goldDir = 0;
+	if(emuLoadEEPROM(image) <= 0) { fprintf(stderr, "can't read %s\n", image); return 2; }
+	cacheFlush();
+	
+	emuAnalog[Vbat] = 600;
+	s = emuStats;
+	phone.IOinit();
+	phone.LCDinit(64,4);
+	phone.EEreadbyte = &readB;
+	phone.EEreadmem = &readM;
+	frame("init", &s);
+	
+	phone.drawRect(0, 0, LCDWIDTH, LCDHEIGHT);
+	phone.fillRect(4, 4, 20, 13);
+	phone.hLine(30, 9, 40);
+	phone.vLine(50, 3, 30);
+	phone.fillRect(10, 20, 30, 10, BLIT_XOR);
+	for(uint8_t i = 0; i < 30; i++) phone.SetPx(45 + i, 40 - i / 3);
+	phone.display();
+	frame("primitives", &s);
+	
+	//same picture again: with LCD_SHADOW it should send nothing
+	phone.clearDisplay();
+	phone.drawRect(0, 0, LCDWIDTH, LCDHEIGHT);
+	phone.fillRect(4, 4, 20, 13);
+	phone.hLine(30, 9, 40);
+	phone.vLine(50, 3, 30);
+	phone.fillRect(10, 20, 30, 10, BLIT_XOR);
+	for(uint8_t i = 0; i < 30; i++) phone.SetPx(45 + i, 40 - i / 3);
+	phone.display();
+	frame("redraw", &s);
+	
+	phone.fillRect(60, 30, 8, 8, BLIT_ANDNOT);
+	phone.displayAsync();
+	phone.displayWait();
+	frame("async", &s);
+	
+	phone.clearDisplay();
+	phone.battBar();
+	phone.display();
+	frame("battery", &s);
+	
+	phone.clearDisplay();
+	phone.LCDputsC((char*)"Multimeter", 0, 0);
+	phone.LCDputsL((char*)"12.34", 1, 10);
+	phone.LCDputsR((char*)"V", 4, LCDWIDTH - 3, 1);
+	phone.LCDputsC((char*)"Menu", 5, 0);
+	phone.display();
+	frame("text", &s);
+	
+	phone.LCDputsL((char*)"12.35", 1, 10);
+	phone.display();
+	frame("digit", &s);
+	
+	//packed round trip: the top half never repeats a byte, so it packs
+	//into literals of 128 bytes (header 127), the blank bottom into repeats
+	{
+		uint8_t rows[LCDWIDTH * LCDHEIGHT / 8];
+		long n, bad = 0;
+		
+		for(n = 0; n < (long)sizeof(rows); n++) rows[n] = (n < (long)sizeof(rows) / 2) ? (uint8_t)(n * 37) ^ 0x5A : 0;
+		emuEEPROM[PACKED_AT] = LCDWIDTH | BMP_PACKED;
+		emuEEPROM[PACKED_AT + 1] = LCDHEIGHT;
+		Bytes p = packBits(Bytes(rows, rows + sizeof(rows)));
+		memcpy(emuEEPROM + PACKED_AT + 2, &p[0], p.size());
+		cacheFlush();
+		phone.putBmp(PACKED_AT - idx_zbmp, 0, 0);
+		for(n = 0; n < (long)sizeof(rows); n++)
+			if(phone.lcd_buffer[n] != rows[n]) bad++;
+		if(bad) { printf("packed bitmap: %ld bytes decoded wrong\n", bad); failed = 1; }
+		phone.display();
+		frame("packed", &s);
+	}
+	
+	//animation hanging off the right edge: the delta run must be clipped
+	//at column 83 instead of spilling into the next bank
+	{
+		uint8_t *e = emuEEPROM + PACKED_AT + 0x400;
+		uint8_t want[LCDWIDTH * LCDHEIGHT / 8];
+		AniPlayer ani;
+		long bad = 0;
+		
+		e[0] = 2; //frames
+		e[1] = 42; //keyframe length
+		e[2] = 0;
+		e[3] = 40; //raw 40x8 keyframe
+		e[4] = 8;
+		for(uint8_t i = 0; i < 40; i++) e[5 + i] = i * 5;
+		e[45] = 1; //one run, all 40 bytes inverted
+		e[46] = 0;
+		e[47] = 0;
+		e[48] = 40;
+		memset(e + 49, 0xFF, 40);
+		cacheFlush();
+		
+		phone.clearDisplay();
+		memset(want, 0, sizeof(want));
+		for(uint8_t i = 0; i < LCDWIDTH - 60; i++) want[LCDWIDTH + 60 + i] = (i * 5) ^ 0xFF;
+		phone.aniStart(&ani, PACKED_AT + 0x400 - idx_zbmp, 1, 60);
+		if(!phone.aniStep(&ani) || phone.aniStep(&ani)) { printf("animation: wrong frame count\n"); failed = 1; }
+		for(long n = 0; n < (long)sizeof(want); n++)
+			if(phone.lcd_buffer[n] != want[n]) bad++;
+		if(bad) { printf("animation: %ld bytes wrong\n", bad); failed = 1; }
+		phone.display();
+		frame("ani clip", &s);
+	}
+	
+	//the mixed screen read through the hooks, then through an EEStream:
+	//the picture must be the same, only the chip selects and bytes change
+	{
+		uint8_t rows[32 * 2], hooks[LCDWIDTH * LCDHEIGHT / 8];
+		uint8_t *e = emuEEPROM + RAW_AT;
+		EEStream stream;
+		EmuStats h, t;
+		long n, bad = 0;
+		
+		e[0] = 24; //raw 24x16, drawn with one more row of 24 bytes
+		e[1] = 16;
+		for(n = 0; n < 24 * 3; n++) e[2 + n] = (uint8_t)(n * 11) | 0x81;
+		for(n = 0; n < (long)sizeof(rows); n++) rows[n] = (n & 8) ? 0xAA : (uint8_t)(n * 3);
+		emuEEPROM[PACKED_AT + 0x500] = 32 | BMP_PACKED;
+		emuEEPROM[PACKED_AT + 0x501] = 16;
+		Bytes p = packBits(Bytes(rows, rows + sizeof(rows)));
+		memcpy(emuEEPROM + PACKED_AT + 0x502, &p[0], p.size());
+		cacheFlush();
+		
+		h = emuStats;
+		drawMixed();
+		memcpy(hooks, phone.lcd_buffer, sizeof(hooks));
+		t = emuStats;
+		phone.EEstream = &stream;
+		drawMixed();
+		phone.EEstream = 0;
+		for(n = 0; n < (long)sizeof(hooks); n++)
+			if(phone.lcd_buffer[n] != hooks[n]) bad++;
+		printf("stream: hooks %lu selects %lu bytes, stream %lu selects %lu bytes\n",
+			t.eeSelects - h.eeSelects, t.eeBytes - h.eeBytes,
+			emuStats.eeSelects - t.eeSelects, emuStats.eeBytes - t.eeBytes);
+		if(bad) { printf("stream: %ld bytes differ from the hooks\n", bad); failed = 1; }
+		phone.display();
+		frame("stream", &s);
+	}
+	
+#if GLYPH_CACHE > 0
+	printf("glyph cache: %u hits, %u misses\n", phone.glyphHits, phone.glyphMisses);
+#endif
+#if EECACHE_LINES > 0
+	printf("EEPROM cache: %u hits, %u misses\n", eeHits, eeMisses);
+#endif
+	return failed;
+}
@@ -0,0 +1,155 @@
+/*
+  pgatest - runs the PGA sampling engine, calibration and measurements of
+  EED2/PGA.cpp on the host against an emulated front end.
+
+  Build and run from the repository root:
+    g++ -O2 -I tools/emu -I p3310 -I EED2 -o pgatest tools/emu/emu.cpp tools/emu/pgatest.cpp EED2/PGA.cpp p3310/p3310.cpp
+    ./pgatest
+
+  The front end has the errors calibration is there for: an input divider
+  off by DIV_ERR, a gain error and a zero offset for every PGA gain, and a
+  step of noise that dithers the oversampled readings. The test calibrates
+  like the Calibrate screen does, then checks a few voltages and known
+  resistors. The resistors reach the ADC through R2 from vref and not
+  through the divider, so its error must not show up there. The exit
+  status is 1 when a reading is off by more than TOLERANCE.
+
+    Copyright (C) 2015 Cristiano Griletti
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <p3310.h>
+#include <spieeprom.h>
+#include <math.h>
+#include "PGA.h"
+#include "emu.h"
+
+#define DIV_ERR 1.02 //real divider ratio over the nominal Vdiv
+#define TOLERANCE 0.005 //of the expected reading
+
+PGA pga;
+SPIEEPROM disk1(1);
+
+static const double gainErr[8] = {0.001, -0.002, 0.0015, 0.0005, -0.001, 0.002, -0.0025, 0.003};
+static const double offSteps[2][8] = {
+	{0.6, 0.9, -0.4, 1.2, 0.3, -0.7, 1.5, 0.8},
+	{-0.5, 0.4, 0.7, -0.9, 1.1, 0.2, -0.3, 0.6}};
+
+static long vin; //mV on the probes
+static long rx = -1; //mohm between the probes in resistance mode, -1 for voltage
+static int failed;
+
+byte readB(long addr)
+{
+	byte b;
+	busTake(BUS_EE);
+	b = disk1.read_byte(addr);
+	busRelease();
+	return b;
+}
+void readM(long addr, byte * buff, long size)
+{
+	busTake(BUS_EE);
+	disk1.read_mem(addr, buff, size);
+	busRelease();
+}
+void writeM(long addr, byte * buff, int size)
+{
+	busTake(BUS_EE);
+	disk1.write(addr, buff, size);
+	busRelease();
+}
+
+//The front end: mV at the PGA input of the channel, times the gain, at
+//2 mV a step over the one step the ADC reads at zero
+static int frontEnd(uint8_t ch, uint8_t g)
+{
+	static const uint8_t gains[8] = {1,2,5,10,20,50,100,200};
+	double node = 0, steps;
+
+	if(ch == 0)
+	{
+		if(rx >= 0) node = (double)vref * R2 * 100 / (R2 * 100.0 + rx - RES_LEAD);
+		else node = vin / (Vdiv * DIV_ERR);
+	}
+	steps = (node * gains[g] * (1 + gainErr[g]) / 2) + 1 + offSteps[ch][g];
+	return (int)floor(steps + ((double)rand() / RAND_MAX)); //dithered, the mean is steps
+}
+
+static void check(const char *what, long got, long want)
+{
+	double err = (double)(got - want) / want;
+
+	printf("%-10s %9ld want %9ld  %+.3f%%", what, got, want, err * 100);
+	if(fabs(err) > TOLERANCE) { printf("  OFF"); failed = 1; }
+	printf("\n");
+}
+
+//A reading, once the engine has the samples for it
+static long settle(long (*measure)(void))
+{
+	long v;
+	for(uint8_t tries = 0; tries < 20; tries++)
+		if((v = measure()) != -1) return v;
+	return -1;
+}
+static long volts(void) { return pga.MeasureVoltage(0); }
+static long ohms(void) { return pga.MeasureRes(0); }
+
+int main(int argc, char **argv)
+{
+	static const long vRef[] = {24000, 5000, 500};
+	static const long vTest[] = {15000, 3000, 250};
+	static const long rTest[] = {1000000L, 10000000L, 100000000L}; //mohm
+	uint8_t i;
+	char name[16];
+
+	emuADC = &frontEnd;
+	pga.EEreadbyte = &readB;
+	pga.EEreadmem = &readM;
+	pga.EEwritemem = &writeM;
+	pga.init();
+
+	pga.calReset();
+	pga.calZero(0);
+	pga.calZero(1);
+	for(i = 0; i < 3; i++)
+	{
+		vin = vRef[i];
+		pga.calRef(0, vRef[i]);
+	}
+	rx = 10000000L;
+	pga.calRes(rx);
+	rx = -1;
+	printf("calibrated gains V%02X R%d\n", pga.calDone(0), pga.calResDone());
+	if((pga.calDone(0) != 0xFF) || !pga.calResDone()) failed = 1;
+	pga.calSave();
+	if(!pga.calLoad()) { printf("calibration didn't read back\n"); failed = 1; }
+
+	pga.osBits = ADC_OS_MAX;
+	for(i = 0; i < 3; i++)
+	{
+		vin = vTest[i];
+		snprintf(name, sizeof(name), "%ld mV", vTest[i]);
+		check(name, settle(&volts), vTest[i]);
+	}
+	for(i = 0; i < 3; i++)
+	{
+		rx = rTest[i];
+		snprintf(name, sizeof(name), "%ld ohm", rTest[i] / 1000);
+		check(name, settle(&ohms), rTest[i]);
+	}
+	return failed;
+}
@@ -0,0 +1,24 @@
+//Host stand-in for the SPIEEPROM library, backed by the emulated chip in emu.cpp
+#ifndef EMU_SPIEEPROM_H_
+#define EMU_SPIEEPROM_H_
+
+#include <Arduino.h>
+
+#define SLAVESELECT 10
+
+class SPIEEPROM
+{
+	public:
+	SPIEEPROM() {}
+	SPIEEPROM(byte type) {}
+	void setup(void) {}
+	void send_address(long addr);
+	void start_write(void);
+	bool isWIP(void) { return false; }
+	void write(long addr, byte data);
+	void write(long addr, byte data[], int arrLength);
+	byte read_byte(long addr);
+	void read_mem(long addr, byte buffer[], int length);
+};
+
+#endif
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Builds the emulator with each optional feature of p3310 turned on and
+# runs every build against the goldens in tools/emu/ref. The features are
+# off in the firmware for RAM, so this is where their code runs. All
+# builds must draw the same frames, their byte counts show what each
+# feature saves. Run from the repository root; exits 1 if any build fails.
+
+out=${TMPDIR:-/tmp}/p3310emu-builds
+failed=0
+mkdir -p "$out" || exit 1
+
+run() {
+	name=$1
+	shift
+	echo "== $name $*"
+	if g++ -O2 "$@" -I tools/emu -I p3310 -I EED2 -o "$out/$name" \
+		tools/emu/emu.cpp tools/emu/main.cpp p3310/p3310.cpp EED2/eecache.cpp &&
+		"$out/$name"
+	then :
+	else
+		echo "== $name FAILED"
+		failed=1
+	fi
+}
+
+run plain
+run shadow -DLCD_SHADOW
+run glyphs -DGLYPH_CACHE=12
+run prefetch -DBMP_PREFETCH=130
+run eecache -DEECACHE_LINES=8 -DEECACHE_LINE=32
+
+exit $failed